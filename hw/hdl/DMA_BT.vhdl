@@ -0,0 +1,216 @@
+-- #############################################################################
+-- DMA_BT.vhdl
+--
+-- BOARD         : DE0-Nano-SoC from Terasic
+-- Revision      : 1.0
+--
+-- Syntax Rule : nGROUP_NAME[bit]
+--
+-- n     : to specify an active-low signal
+-- GROUP : specify the source of the signal (ex: UART, FIFO_in, ...)
+-- NAME  : signal name (ex: write, read, ...)
+-- #############################################################################
+--
+-- Two DMA channels between memory and the HC05 FIFOs :
+--  - TX : a read master fetches one 32 bits word and pushes its bytes to the
+--         FIFO_out, from DMA_tx_addr, DMA_tx_len bytes,
+--  - RX : bytes popped from the FIFO_in are written to memory by a write
+--         master, one byte lane per access, from DMA_rx_addr, DMA_rx_len bytes.
+-- Writing a length starts the channel if it is idle, writing 0 aborts it.
+-- The FIFOs are shared with the CPU, a channel only uses a FIFO port on the
+-- cycles the slave does not. A done pulse is sent to registers_BT at the end
+-- of each transfer (not after an abort).
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity DMA_BT is
+    port(
+        clk                 : in    std_logic;
+        nReset              : in    std_logic;
+    -- Registers (written through the slave of HC05_extension)
+        as_address          : in    std_logic_vector(4  downto 0);
+        as_write            : in    std_logic;
+        as_writedata        : in    std_logic_vector(31 downto 0);
+        DMA_tx_addr         : out   std_logic_vector(31 downto 0);
+        DMA_tx_left         : out   std_logic_vector(31 downto 0);
+        DMA_rx_addr         : out   std_logic_vector(31 downto 0);
+        DMA_rx_left         : out   std_logic_vector(31 downto 0);
+    -- TX read master
+        am_tx_address       : out   std_logic_vector(31 downto 0);
+        am_tx_read          : out   std_logic;
+        am_tx_readdata      : in    std_logic_vector(31 downto 0);
+        am_tx_waitrequest   : in    std_logic;
+    -- RX write master
+        am_rx_address       : out   std_logic_vector(31 downto 0);
+        am_rx_write         : out   std_logic;
+        am_rx_writedata     : out   std_logic_vector(31 downto 0);
+        am_rx_byteenable    : out   std_logic_vector(3  downto 0);
+        am_rx_waitrequest   : in    std_logic;
+    -- FIFO_out interface
+        FIFO_out_write      : out   std_logic;
+        FIFO_out_writedata  : out   std_logic_vector(7  downto 0);
+        FIFO_out_full       : in    std_logic;
+        FIFO_out_busy       : in    std_logic; -- the slave pushes this cycle
+    -- FIFO_in interface
+        FIFO_in_read        : out   std_logic;
+        FIFO_in_readdata    : in    std_logic_vector(7  downto 0);
+        FIFO_in_empty       : in    std_logic;
+        FIFO_in_busy        : in    std_logic; -- the slave pops this cycle
+    -- registers_BT interface
+        DMA_tx_done         : out   std_logic;
+        DMA_rx_done         : out   std_logic
+    );
+end entity DMA_BT;
+
+architecture rtl of DMA_BT is
+type tx_state_t is (TX_IDLE, TX_READ, TX_PUSH);
+type rx_state_t is (RX_IDLE, RX_POP, RX_CAPTURE, RX_WRITE);
+signal tx_state     : tx_state_t;
+signal tx_addr      : unsigned(31 downto 0);
+signal tx_left      : unsigned(31 downto 0);
+signal tx_abort     : std_logic;
+signal tx_word      : std_logic_vector(31 downto 0);
+signal tx_byte      : std_logic_vector(7  downto 0);
+signal tx_push_now  : std_logic;
+signal rx_state     : rx_state_t;
+signal rx_addr      : unsigned(31 downto 0);
+signal rx_left      : unsigned(31 downto 0);
+signal rx_abort     : std_logic;
+signal rx_byte      : std_logic_vector(7  downto 0);
+signal rx_pop_now   : std_logic;
+
+begin
+
+DMA_tx_addr         <= std_logic_vector(tx_addr);
+DMA_tx_left         <= std_logic_vector(tx_left);
+DMA_rx_addr         <= std_logic_vector(rx_addr);
+DMA_rx_left         <= std_logic_vector(rx_left);
+
+-- TX : byte lane tx_addr(1 downto 0) of the word last read
+am_tx_address       <= std_logic_vector(tx_addr(31 downto 2)) & "00";
+am_tx_read          <= '1' when tx_state = TX_READ else '0';
+tx_byte             <= tx_word(7  downto 0)  when tx_addr(1 downto 0) = "00"
+                  else tx_word(15 downto 8)  when tx_addr(1 downto 0) = "01"
+                  else tx_word(23 downto 16) when tx_addr(1 downto 0) = "10"
+                  else tx_word(31 downto 24);
+tx_push_now         <= '1' when tx_state = TX_PUSH and tx_abort = '0'
+                        and FIFO_out_full = '0' and FIFO_out_busy = '0' else '0';
+FIFO_out_write      <= tx_push_now;
+FIFO_out_writedata  <= tx_byte;
+
+-- RX : the byte is on every lane, byteenable selects rx_addr(1 downto 0)
+am_rx_address       <= std_logic_vector(rx_addr(31 downto 2)) & "00";
+am_rx_write         <= '1' when rx_state = RX_WRITE else '0';
+am_rx_writedata     <= rx_byte & rx_byte & rx_byte & rx_byte;
+am_rx_byteenable    <= "0001" when rx_addr(1 downto 0) = "00"
+                  else "0010" when rx_addr(1 downto 0) = "01"
+                  else "0100" when rx_addr(1 downto 0) = "10"
+                  else "1000";
+rx_pop_now          <= '1' when rx_state = RX_POP and rx_abort = '0'
+                        and FIFO_in_empty = '0' and FIFO_in_busy = '0' else '0';
+FIFO_in_read        <= rx_pop_now;
+
+tx_channel : process(clk, nReset)
+begin
+    if(nReset = '0') then
+        tx_state    <= TX_IDLE;
+        tx_addr     <= (others => '0');
+        tx_left     <= (others => '0');
+        tx_abort    <= '0';
+        tx_word     <= (others => '0');
+        DMA_tx_done <= '0';
+    elsif(rising_edge(clk)) then
+        DMA_tx_done <= '0';
+        if(as_write = '1' and as_address = "01101") then
+            tx_addr     <= unsigned(as_writedata);
+        end if;
+        if(as_write = '1' and as_address = "01110") then
+            if(tx_state = TX_IDLE) then
+                tx_left     <= unsigned(as_writedata);
+            elsif(unsigned(as_writedata) = 0) then
+                tx_abort    <= '1';
+            end if;
+        end if;
+        case tx_state is
+        when TX_IDLE =>
+            tx_abort    <= '0';
+            if(tx_left /= 0) then
+                tx_state    <= TX_READ;
+            end if;
+        when TX_READ =>
+            if(am_tx_waitrequest = '0') then
+                tx_word     <= am_tx_readdata;
+                tx_state    <= TX_PUSH;
+            end if;
+        when TX_PUSH =>
+            if(tx_abort = '1') then
+                tx_left     <= (others => '0');
+                tx_state    <= TX_IDLE;
+            elsif(tx_push_now = '1') then
+                tx_addr     <= tx_addr + 1;
+                tx_left     <= tx_left - 1;
+                if(tx_left = 1) then
+                    DMA_tx_done <= '1';
+                    tx_state    <= TX_IDLE;
+                elsif(tx_addr(1 downto 0) = "11") then --next word
+                    tx_state    <= TX_READ;
+                end if;
+            end if;
+        end case;
+    end if;
+end process tx_channel;
+
+rx_channel : process(clk, nReset)
+begin
+    if(nReset = '0') then
+        rx_state    <= RX_IDLE;
+        rx_addr     <= (others => '0');
+        rx_left     <= (others => '0');
+        rx_abort    <= '0';
+        rx_byte     <= (others => '0');
+        DMA_rx_done <= '0';
+    elsif(rising_edge(clk)) then
+        DMA_rx_done <= '0';
+        if(as_write = '1' and as_address = "01111") then
+            rx_addr     <= unsigned(as_writedata);
+        end if;
+        if(as_write = '1' and as_address = "10000") then
+            if(rx_state = RX_IDLE) then
+                rx_left     <= unsigned(as_writedata);
+            elsif(unsigned(as_writedata) = 0) then
+                rx_abort    <= '1';
+            end if;
+        end if;
+        case rx_state is
+        when RX_IDLE =>
+            rx_abort    <= '0';
+            if(rx_left /= 0) then
+                rx_state    <= RX_POP;
+            end if;
+        when RX_POP =>
+            if(rx_abort = '1') then
+                rx_left     <= (others => '0');
+                rx_state    <= RX_IDLE;
+            elsif(rx_pop_now = '1') then
+                rx_state    <= RX_CAPTURE;
+            end if;
+        when RX_CAPTURE => -- FIFO_in has no show-ahead
+            rx_byte     <= FIFO_in_readdata;
+            rx_state    <= RX_WRITE;
+        when RX_WRITE =>
+            if(am_rx_waitrequest = '0') then
+                rx_addr     <= rx_addr + 1;
+                rx_left     <= rx_left - 1;
+                if(rx_left = 1) then
+                    DMA_rx_done <= '1';
+                    rx_state    <= RX_IDLE;
+                else
+                    rx_state    <= RX_POP;
+                end if;
+            end if;
+        end case;
+    end if;
+end process rx_channel;
+end;
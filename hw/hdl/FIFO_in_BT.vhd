@@ -14,6 +14,9 @@
 -- ************************************************************
 -- THIS IS A WIZARD-GENERATED FILE. DO NOT EDIT THIS FILE!
 --
+-- Edited by hand : the depth is the DEPTH_LOG2 generic (10 => 1024 words,
+-- as generated, up to 14 => 16384 words), usedw follows it.
+--
 -- 16.1.2 Build 203 01/18/2017 SJ Lite Edition
 -- ************************************************************
 
@@ -41,6 +44,10 @@ LIBRARY altera_mf;
 USE altera_mf.all;
 
 ENTITY FIFO_in_BT IS
+	GENERIC
+	(
+		DEPTH_LOG2	: NATURAL RANGE 10 TO 14 := 10
+	);
 	PORT
 	(
 		aclr		: IN STD_LOGIC ;
@@ -50,7 +57,7 @@ ENTITY FIFO_in_BT IS
 		wrreq		: IN STD_LOGIC ;
 		full		: OUT STD_LOGIC ;
 		q		: OUT STD_LOGIC_VECTOR (7 DOWNTO 0);
-		usedw		: OUT STD_LOGIC_VECTOR (9 DOWNTO 0)
+		usedw		: OUT STD_LOGIC_VECTOR (DEPTH_LOG2-1 DOWNTO 0)
 	);
 END FIFO_in_BT;
 
@@ -59,7 +66,7 @@ ARCHITECTURE SYN OF fifo_in_BT IS
 
 	SIGNAL sub_wire0	: STD_LOGIC ;
 	SIGNAL sub_wire1	: STD_LOGIC_VECTOR (7 DOWNTO 0);
-	SIGNAL sub_wire2	: STD_LOGIC_VECTOR (9 DOWNTO 0);
+	SIGNAL sub_wire2	: STD_LOGIC_VECTOR (DEPTH_LOG2-1 DOWNTO 0);
 
 
 
@@ -84,24 +91,24 @@ ARCHITECTURE SYN OF fifo_in_BT IS
 			wrreq	: IN STD_LOGIC ;
 			full	: OUT STD_LOGIC ;
 			q	: OUT STD_LOGIC_VECTOR (7 DOWNTO 0);
-			usedw	: OUT STD_LOGIC_VECTOR (9 DOWNTO 0)
+			usedw	: OUT STD_LOGIC_VECTOR (DEPTH_LOG2-1 DOWNTO 0)
 	);
 	END COMPONENT;
 
 BEGIN
 	full    <= sub_wire0;
 	q    <= sub_wire1(7 DOWNTO 0);
-	usedw    <= sub_wire2(9 DOWNTO 0);
+	usedw    <= sub_wire2(DEPTH_LOG2-1 DOWNTO 0);
 
 	scfifo_component : scfifo
 	GENERIC MAP (
 		add_ram_output_register => "OFF",
 		intended_device_family => "Cyclone V",
-		lpm_numwords => 1024,
+		lpm_numwords => 2**DEPTH_LOG2,
 		lpm_showahead => "OFF",
 		lpm_type => "scfifo",
 		lpm_width => 8,
-		lpm_widthu => 10,
+		lpm_widthu => DEPTH_LOG2,
 		overflow_checking => "ON",
 		underflow_checking => "ON",
 		use_eab => "ON"
@@ -15,14 +15,22 @@
 
 library ieee;
 use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
 
 entity HC05_extension is
+    generic(
+        -- CRC-16/CCITT accumulators on the FIFO_out and FIFO_in bytes
+        CRC_UNIT            : boolean := true;
+        -- FIFO depths, 10 => 1024 words up to 14 => 16384 words
+        FIFO_OUT_DEPTH_LOG2 : natural range 10 to 14 := 10;
+        FIFO_IN_DEPTH_LOG2  : natural range 10 to 14 := 10
+    );
     port(
         clk             : in    std_logic;
         nReset          : in    std_logic;
 
         -- Slave interface
-        as_address      : in    std_logic_vector(2  downto 0);
+        as_address      : in    std_logic_vector(4  downto 0);
         
         as_read         : in    std_logic;
         as_readdata     : out   std_logic_vector(31 downto 0);
@@ -30,10 +38,26 @@ entity HC05_extension is
         as_write        : in    std_logic;
         as_writedata    : in    std_logic_vector(31 downto 0);
         as_byteenable   : in    std_logic_vector(3  downto 0);
+        as_waitrequest  : out   std_logic;
+
+        -- DMA TX read master
+        am_tx_address       : out   std_logic_vector(31 downto 0);
+        am_tx_read          : out   std_logic;
+        am_tx_readdata      : in    std_logic_vector(31 downto 0);
+        am_tx_waitrequest   : in    std_logic;
+
+        -- DMA RX write master
+        am_rx_address       : out   std_logic_vector(31 downto 0);
+        am_rx_write         : out   std_logic;
+        am_rx_writedata     : out   std_logic_vector(31 downto 0);
+        am_rx_byteenable    : out   std_logic_vector(3  downto 0);
+        am_rx_waitrequest   : in    std_logic;
         
         -- Conduit interface towards GPIO
         BLT_Rx          : in    std_logic;
         BLT_Tx          : out   std_logic;
+        nBLT_RTS        : out   std_logic; -- '0' : the HC05 may send
+        nBLT_CTS        : in    std_logic; -- '0' : the HC05 accepts data
         
         -- Interrupts
         irq             : out   std_logic
@@ -41,6 +65,25 @@ entity HC05_extension is
 end entity HC05_extension;
 
 architecture rtl of HC05_extension is
+    type unpack_state_t is (UNPACK_IDLE, UNPACK_POP, UNPACK_DONE);
+
+    -- CRC-16/CCITT (poly 0x1021, MSB first) of one more byte
+    function crc16_update(crc : std_logic_vector(15 downto 0);
+                          data : std_logic_vector(7 downto 0))
+        return std_logic_vector is
+        variable c : std_logic_vector(15 downto 0);
+    begin
+        c := crc xor (data & x"00");
+        for i in 0 to 7 loop
+            if(c(15) = '1') then
+                c := (c(14 downto 0) & '0') xor x"1021";
+            else
+                c := c(14 downto 0) & '0';
+            end if;
+        end loop;
+        return c;
+    end function crc16_update;
+
     -- positive reset for FIFOs
     signal reset_out        : std_logic;
     signal reset_in         : std_logic;
@@ -49,17 +92,25 @@ architecture rtl of HC05_extension is
         -- registers <---> FIFO_out
             signal FIFO_out_write       : std_logic;
             signal FIFO_out_writedata   : std_logic_vector(7  downto 0);
-            signal FIFO_out_use_dw      : std_logic_vector(9  downto 0);
+            signal FIFO_out_use_dw      : std_logic_vector(FIFO_OUT_DEPTH_LOG2-1 downto 0);
             signal FIFO_out_full        : std_logic;
         -- registers <---> FIFO_in
-            signal FIFO_in_use_dw       : std_logic_vector(9  downto 0);
+            signal FIFO_in_use_dw       : std_logic_vector(FIFO_IN_DEPTH_LOG2-1 downto 0);
         -- registers  ---> UART
             signal UART_on              : std_logic;
             signal UART_parity          : std_logic_vector(1  downto 0);
             signal UART_stop_bit        : std_logic;
             signal UART_wait_cycles     : std_logic_vector(31 downto 0);
+            signal UART_frac_on         : std_logic;
+            signal UART_baud_frac       : std_logic_vector(7  downto 0);
+            signal UART_oversample      : std_logic;
+            signal UART_flow_on         : std_logic;
+            signal UART_rx_stop         : std_logic;
             signal UART_data_dropped    : std_logic;
             signal UART_data_received   : std_logic;
+            signal UART_parity_error    : std_logic;
+            signal UART_tx_busy         : std_logic;
+            signal UART_tx_gap          : std_logic;
         -- UART <---> FIFO_out
             signal UART_read            : std_logic;
             signal FIFO_out_readdata    : std_logic_vector(7  downto 0);
@@ -74,51 +125,288 @@ architecture rtl of HC05_extension is
             signal registers_readdata   : std_logic_vector(31 downto 0);
             signal FIFO_in_readdata     : std_logic_vector(7  downto 0);
             signal read_pending         : std_logic;
+            signal read_issue           : std_logic;
+        -- Packed writes towards FIFO_out
+            signal access_hold          : std_logic;
+            signal waitrequest          : std_logic;
+            signal registers_write      : std_logic;
+            signal pack_data            : std_logic_vector(31 downto 0);
+            signal pack_valid           : std_logic_vector(3  downto 0);
+            signal pack_write           : std_logic;
+            signal pack_writedata       : std_logic_vector(7  downto 0);
+        -- Packed reads from FIFO_in
+            signal unpack_state         : unpack_state_t;
+            signal unpack_left          : unsigned(2 downto 0);
+            signal unpack_lane          : unsigned(1 downto 0);
+            signal unpack_capture       : std_logic;
+            signal unpack_read          : std_logic;
+            signal unpack_word          : std_logic_vector(31 downto 0);
+            signal unpack_count         : std_logic_vector(2  downto 0);
+        -- CRC accumulators
+            signal FIFO_in_read_d       : std_logic;
+            signal crc_out              : std_logic_vector(15 downto 0);
+            signal crc_in               : std_logic_vector(15 downto 0);
+        -- DMA channels
+            signal FIFO_out_write_cpu   : std_logic;
+            signal FIFO_in_read_cpu     : std_logic;
+            signal FIFO_in_empty        : std_logic;
+            signal DMA_FIFO_out_write   : std_logic;
+            signal DMA_FIFO_out_writedata : std_logic_vector(7  downto 0);
+            signal DMA_FIFO_in_read     : std_logic;
+            signal DMA_tx_addr          : std_logic_vector(31 downto 0);
+            signal DMA_tx_left          : std_logic_vector(31 downto 0);
+            signal DMA_rx_addr          : std_logic_vector(31 downto 0);
+            signal DMA_rx_left          : std_logic_vector(31 downto 0);
+            signal DMA_tx_done          : std_logic;
+            signal DMA_rx_done          : std_logic;
+        -- capabilities : FIFO depths, CRC unit, DMA
+            signal caps                 : std_logic_vector(31 downto 0);
 begin
+-- the packer pushes one byte per cycle, hold any access until it is done
+-- a read at "01010" is held until the unpacker has collected its bytes
+access_hold     <= '1' when (as_read = '1' or as_write = '1') and pack_valid /= "0000"
+                    else '1' when as_read = '1' and as_address = "01010" and unpack_state /= UNPACK_DONE
+                    else '0';
+-- a read is issued to the FIFO_in or the registers in its first free cycle,
+-- waitrequest held, and accepted the next cycle with its data (readLatency 0,
+-- the master still drives as_address)
+read_issue      <= as_read and not read_pending and not access_hold;
+waitrequest     <= access_hold or read_issue;
+as_waitrequest  <= waitrequest;
+registers_write <= as_write and not waitrequest;
+
+-- capabilities register : log2 of the FIFO_out depth (4..0), of the FIFO_in
+-- depth (12..8), CRC unit (16), DMA channels (17)
+caps(31 downto 18)  <= (others => '0');
+caps(17)            <= '1';
+caps(16)            <= '1' when CRC_UNIT else '0';
+caps(15 downto 13)  <= (others => '0');
+caps(12 downto 8)   <= std_logic_vector(to_unsigned(FIFO_IN_DEPTH_LOG2, 5));
+caps(7  downto 5)   <= (others => '0');
+caps(4  downto 0)   <= std_logic_vector(to_unsigned(FIFO_OUT_DEPTH_LOG2, 5));
+
 -- FIFO reset
-reset_in    <= '1' when as_address = "111" and as_write = '1' and as_writedata(0) = '1' else not nReset;
-reset_out   <= '1' when as_address = "111" and as_write = '1' and as_writedata(1) = '1' else not nReset;
+reset_in    <= '1' when as_address = "00111" and registers_write = '1' and as_writedata(0) = '1' else not nReset;
+reset_out   <= '1' when as_address = "00111" and registers_write = '1' and as_writedata(1) = '1' else not nReset;
 
 -- arbitrator between FIFO_in and registers
-FIFO_in_read    <= '1' when as_read = '1' and as_address = "101" and read_pending = '0' else '0';
-registers_read  <= '1' when as_read = '1' and as_address /= "101" and read_pending = '0' else '0';
-as_readdata     <= (31 downto 8 => '0') & FIFO_in_readdata when read_pending = '1' and as_address = "101"
+FIFO_in_read_cpu <= '1' when read_issue = '1' and as_address = "00101"
+                    else unpack_read;
+FIFO_in_read    <= FIFO_in_read_cpu or DMA_FIFO_in_read;
+FIFO_in_empty   <= '1' when FIFO_in_full = '0' and unsigned(FIFO_in_use_dw) = 0 else '0';
+-- RTS stays asserted without flow control
+nBLT_RTS        <= UART_rx_stop when UART_flow_on = '1' else '0';
+registers_read  <= '1' when read_issue = '1' and as_address /= "00101" else '0';
+as_readdata     <= (31 downto 8 => '0') & FIFO_in_readdata when read_pending = '1' and as_address = "00101"
+                    else unpack_word when read_pending = '1' and as_address = "01010"
+                    else x"0000" & crc_out when read_pending = '1' and as_address = "01011"
+                    else x"0000" & crc_in when read_pending = '1' and as_address = "01100"
+                    else DMA_tx_addr when read_pending = '1' and as_address = "01101"
+                    else DMA_tx_left when read_pending = '1' and as_address = "01110"
+                    else DMA_rx_addr when read_pending = '1' and as_address = "01111"
+                    else DMA_rx_left when read_pending = '1' and as_address = "10000"
+                    else caps when read_pending = '1' and as_address = "10001"
                     else registers_readdata when read_pending = '1'
                     else (others => '0');
                     
-FIFO_out_write      <= '1' when as_write = '1' and as_address = "011" else '0';
-FIFO_out_writedata  <=  as_writedata(7 downto 0);
+FIFO_out_write_cpu  <= '1' when (registers_write = '1' and as_address = "00011") or pack_write = '1' else '0';
+FIFO_out_write      <= FIFO_out_write_cpu or DMA_FIFO_out_write;
+FIFO_out_writedata  <= DMA_FIFO_out_writedata when DMA_FIFO_out_write = '1'
+                  else pack_writedata when pack_write = '1'
+                  else as_writedata(7 downto 0);
+
+-- packer : a write at "01001" queues the bytes enabled by as_byteenable,
+-- they are pushed to FIFO_out lowest lane first, one per cycle
+pack_write      <= '1' when pack_valid /= "0000" else '0';
+pack_writedata  <= pack_data(7  downto 0)  when pack_valid(0) = '1'
+              else pack_data(15 downto 8)  when pack_valid(1) = '1'
+              else pack_data(23 downto 16) when pack_valid(2) = '1'
+              else pack_data(31 downto 24);
 
 process(clk)
 begin
     if(rising_edge(clk)) then
-        read_pending <= as_read;
+        read_pending <= read_issue;
     end if;
 end process;
 
+packing : process(clk, nReset)
+begin
+    if(nReset = '0') then
+        pack_data   <= (others => '0');
+        pack_valid  <= (others => '0');
+    elsif(rising_edge(clk)) then
+        if(pack_valid(0) = '1') then
+            pack_valid(0) <= '0';
+        elsif(pack_valid(1) = '1') then
+            pack_valid(1) <= '0';
+        elsif(pack_valid(2) = '1') then
+            pack_valid(2) <= '0';
+        else
+            pack_valid(3) <= '0';
+        end if;
+        if(registers_write = '1' and as_address = "01001") then
+            pack_data   <= as_writedata;
+            pack_valid  <= as_byteenable;
+        end if;
+    end if;
+end process packing;
+
+-- unpacker : a read at "01010" pops min(4, usedw) words from FIFO_in, one per
+-- cycle, and returns them lowest lane first. FIFO_in has no show-ahead, each
+-- word is captured the cycle after its rdreq.
+unpack_read     <= '1' when unpack_state = UNPACK_POP and unpack_left /= 0 else '0';
+
+unpacking : process(clk, nReset)
+begin
+    if(nReset = '0') then
+        unpack_state    <= UNPACK_IDLE;
+        unpack_left     <= (others => '0');
+        unpack_lane     <= (others => '0');
+        unpack_capture  <= '0';
+        unpack_word     <= (others => '0');
+        unpack_count    <= (others => '0');
+    elsif(rising_edge(clk)) then
+        unpack_capture  <= '0';
+        if(unpack_capture = '1') then
+            case unpack_lane is
+            when "00"   => unpack_word(7  downto 0)  <= FIFO_in_readdata;
+            when "01"   => unpack_word(15 downto 8)  <= FIFO_in_readdata;
+            when "10"   => unpack_word(23 downto 16) <= FIFO_in_readdata;
+            when others => unpack_word(31 downto 24) <= FIFO_in_readdata;
+            end case;
+            unpack_lane <= unpack_lane + 1;
+        end if;
+        case unpack_state is
+        when UNPACK_IDLE =>
+            if(as_read = '1' and as_address = "01010") then
+                unpack_word <= (others => '0');
+                unpack_lane <= (others => '0');
+                if(FIFO_in_full = '1' or unsigned(FIFO_in_use_dw) >= 4) then
+                    unpack_left     <= to_unsigned(4, 3);
+                    unpack_count    <= "100";
+                else
+                    unpack_left     <= unsigned(FIFO_in_use_dw(2 downto 0));
+                    unpack_count    <= FIFO_in_use_dw(2 downto 0);
+                end if;
+                unpack_state    <= UNPACK_POP;
+            end if;
+        when UNPACK_POP =>
+            if(unpack_left /= 0) then
+                unpack_left     <= unpack_left - 1;
+                unpack_capture  <= '1';
+            elsif(unpack_capture = '0') then
+                unpack_state    <= UNPACK_DONE;
+            end if;
+        when UNPACK_DONE =>
+            if(as_read = '1' and as_address = "01010" and waitrequest = '0') then --accepted this cycle
+                unpack_state    <= UNPACK_IDLE;
+            end if;
+        end case;
+    end if;
+end process unpacking;
+
+-- CRC accumulators : "01011" follows the bytes pushed to FIFO_out, "01100" the
+-- bytes popped from FIFO_in (single and packed reads), a write seeds them.
+-- A popped byte is on FIFO_in_readdata the cycle after its rdreq.
+crc_gen : if CRC_UNIT generate
+    crc_acc : process(clk, nReset)
+    begin
+        if(nReset = '0') then
+            FIFO_in_read_d  <= '0';
+            crc_out         <= (others => '1');
+            crc_in          <= (others => '1');
+        elsif(rising_edge(clk)) then
+            FIFO_in_read_d  <= FIFO_in_read;
+            if(registers_write = '1' and as_address = "01011") then
+                crc_out <= as_writedata(15 downto 0);
+            elsif(FIFO_out_write = '1' and FIFO_out_full = '0') then
+                crc_out <= crc16_update(crc_out, FIFO_out_writedata);
+            end if;
+            if(registers_write = '1' and as_address = "01100") then
+                crc_in  <= as_writedata(15 downto 0);
+            elsif(FIFO_in_read_d = '1') then
+                crc_in  <= crc16_update(crc_in, FIFO_in_readdata);
+            end if;
+        end if;
+    end process crc_acc;
+end generate crc_gen;
+
+no_crc_gen : if not CRC_UNIT generate
+    FIFO_in_read_d  <= '0';
+    crc_out         <= (others => '0');
+    crc_in          <= (others => '0');
+end generate no_crc_gen;
+
 -- component instantiation
 -- registers
-    registers_BT_inst : entity work.registers_BT PORT MAP (
+    registers_BT_inst : entity work.registers_BT GENERIC MAP (
+        FIFO_OUT_DEPTH_LOG2 => FIFO_OUT_DEPTH_LOG2,
+        FIFO_IN_DEPTH_LOG2  => FIFO_IN_DEPTH_LOG2
+        ) PORT MAP (
         clk                 => clk,
         nReset              => nReset,
         as_address          => as_address,
         as_read             => registers_read,
         as_readdata         => registers_readdata,
-        as_write            => as_write,
+        as_write            => registers_write,
         as_writedata        => as_writedata,
         as_byteenable       => as_byteenable,
         FIFO_out_use_dw     => FIFO_out_use_dw,
         FIFO_out_full       => FIFO_out_full,
         FIFO_in_use_dw      => FIFO_in_use_dw,
         FIFO_in_full        => FIFO_in_full,
+        FIFO_in_last_count  => unpack_count,
+        DMA_tx_done         => DMA_tx_done,
+        DMA_rx_done         => DMA_rx_done,
         UART_on             => UART_on,
         UART_parity         => UART_parity,
         UART_stop_bit       => UART_stop_bit,    
         UART_wait_cycles    => UART_wait_cycles,
+        UART_frac_on        => UART_frac_on,
+        UART_baud_frac      => UART_baud_frac,
+        UART_oversample     => UART_oversample,
+        UART_flow_on        => UART_flow_on,
+        UART_rx_stop        => UART_rx_stop,
         UART_data_dropped   => UART_data_dropped,
         UART_data_received  => UART_data_received,
+        UART_data_sent      => UART_read,
+        UART_parity_error   => UART_parity_error,
+        UART_tx_busy        => UART_tx_busy,
+        UART_tx_gap         => UART_tx_gap,
         irq                 => irq
         );
+-- DMA
+    DMA_BT_inst : entity work.DMA_BT PORT MAP (
+        clk                 => clk,
+        nReset              => nReset,
+        as_address          => as_address,
+        as_write            => registers_write,
+        as_writedata        => as_writedata,
+        DMA_tx_addr         => DMA_tx_addr,
+        DMA_tx_left         => DMA_tx_left,
+        DMA_rx_addr         => DMA_rx_addr,
+        DMA_rx_left         => DMA_rx_left,
+        am_tx_address       => am_tx_address,
+        am_tx_read          => am_tx_read,
+        am_tx_readdata      => am_tx_readdata,
+        am_tx_waitrequest   => am_tx_waitrequest,
+        am_rx_address       => am_rx_address,
+        am_rx_write         => am_rx_write,
+        am_rx_writedata     => am_rx_writedata,
+        am_rx_byteenable    => am_rx_byteenable,
+        am_rx_waitrequest   => am_rx_waitrequest,
+        FIFO_out_write      => DMA_FIFO_out_write,
+        FIFO_out_writedata  => DMA_FIFO_out_writedata,
+        FIFO_out_full       => FIFO_out_full,
+        FIFO_out_busy       => FIFO_out_write_cpu,
+        FIFO_in_read        => DMA_FIFO_in_read,
+        FIFO_in_readdata    => FIFO_in_readdata,
+        FIFO_in_empty       => FIFO_in_empty,
+        FIFO_in_busy        => FIFO_in_read_cpu,
+        DMA_tx_done         => DMA_tx_done,
+        DMA_rx_done         => DMA_rx_done
+        );
 -- UART
     UART_BT_inst : entity work.UART_BT PORT MAP (
         clk                 => clk,
@@ -127,6 +415,7 @@ end process;
         UART_writedata      => UART_writedata,
         BLT_Rx              => BLT_Rx,
         BLT_Tx              => BLT_Tx,
+        nBLT_CTS            => nBLT_CTS,
         UART_read           => UART_read,
         FIFO_out_readdata   => FIFO_out_readdata,
         FIFO_out_empty      => FIFO_out_empty,
@@ -134,12 +423,21 @@ end process;
         UART_parity         => UART_parity,
         UART_stop_bit       => UART_stop_bit,    
         UART_wait_cycles    => UART_wait_cycles,
+        UART_frac_on        => UART_frac_on,
+        UART_baud_frac      => UART_baud_frac,
+        UART_oversample     => UART_oversample,
+        UART_flow_on        => UART_flow_on,
         UART_data_dropped   => UART_data_dropped,
         UART_data_received  => UART_data_received,
+        UART_parity_error   => UART_parity_error,
+        UART_tx_busy        => UART_tx_busy,
+        UART_tx_gap         => UART_tx_gap,
         FIFO_in_full        => FIFO_in_full
         );
 -- FIFO_out
-    FIFO_out_BT_inst : entity work.FIFO_out_BT PORT MAP (
+    FIFO_out_BT_inst : entity work.FIFO_out_BT GENERIC MAP (
+            DEPTH_LOG2 => FIFO_OUT_DEPTH_LOG2
+        ) PORT MAP (
             aclr    => reset_out,
             clock   => clk,
             data    => FIFO_out_writedata,
@@ -151,7 +449,9 @@ end process;
             usedw   => FIFO_out_use_dw
         );
 -- FIFO_in
-    FIFO_in_BT_inst : entity work.FIFO_in_BT PORT MAP (
+    FIFO_in_BT_inst : entity work.FIFO_in_BT GENERIC MAP (
+            DEPTH_LOG2 => FIFO_IN_DEPTH_LOG2
+        ) PORT MAP (
             aclr    => reset_in,
             clock   => clk,
             data    => UART_writedata,
@@ -12,6 +12,23 @@
 -- GROUP : specify the source of the signal (ex: UART, FIFO_in, ...)
 -- NAME  : signal name (ex: write, read, ...)
 -- #############################################################################
+--
+-- Each bit lasts UART_wait_cycles+1 clock cycles. With UART_frac_on, the bits
+-- last one more cycle each time an 8 bits accumulator of UART_baud_frac
+-- overflows, for a bit period of UART_wait_cycles+1+UART_baud_frac/256
+-- cycles on average (the accumulator restarts with each received frame, and
+-- with each burst of transmitted frames).
+-- The next byte is taken from FIFO_out during the stop bits of the frame
+-- being sent, its start bit follows the last stop bit : a burst goes out with
+-- no idle cycle between frames. A byte taken this way is sent even if the
+-- FIFO_out is reset before its frame starts. UART_tx_busy is '1' while a
+-- frame is on BLT_Tx, UART_tx_gap while a byte is ready but BLT_Tx is idle.
+-- With UART_oversample, the frames are received by a second receiver : 16
+-- ticks per bit from a fractional divider, a majority vote of the samples of
+-- ticks 7, 8 and 9, BLT_Rx going through two flip-flops first. It needs
+-- UART_wait_cycles >= 15.
+-- With UART_flow_on, a frame is only started while nBLT_CTS is '0' (after two
+-- flip-flops), the frame being sent is always finished.
 
 library ieee;
 use ieee.std_logic_1164.all;
@@ -28,6 +45,7 @@ entity UART_BT is
     -- Conduit interface towards GPIO
         BLT_Tx              : out   std_logic;
         BLT_Rx              : in    std_logic;
+        nBLT_CTS            : in    std_logic;
     -- FIFO_out interface
         UART_read           : out   std_logic;
         FIFO_out_readdata   : in    std_logic_vector(7  downto 0);
@@ -37,14 +55,22 @@ entity UART_BT is
         UART_parity         : in    std_logic_vector(1  downto 0);
         UART_stop_bit       : in    std_logic;
         UART_wait_cycles    : in    std_logic_vector(31 downto 0);
+        UART_frac_on        : in    std_logic;
+        UART_baud_frac      : in    std_logic_vector(7  downto 0);
+        UART_oversample     : in    std_logic;
+        UART_flow_on        : in    std_logic;
         UART_data_dropped   : out   std_logic;
-        UART_data_received  : out   std_logic
+        UART_data_received  : out   std_logic;
+        UART_parity_error   : out   std_logic; -- frame with a wrong parity bit
+        UART_tx_busy        : out   std_logic; -- a frame is being sent
+        UART_tx_gap         : out   std_logic  -- a byte waits, BLT_Tx idle
     );
 end entity UART_BT;
 
 architecture rtl of UART_BT is
 type UART_snd_state is (snd_WAITING, snd_START, snd_SENDING, snd_PARITY, snd_STOP);
 type UART_rcv_state is (rcv_WAITING, rcv_START, rcv_RECEIVING, rcv_PARITY, rcv_STOP, rcv_RESTART);
+type UART_os_state is (os_WAITING, os_START, os_RECEIVING, os_PARITY, os_STOP);
 -- SEND SIGNALS
 signal snd_state            : UART_snd_state;
 signal snd_counter          : unsigned(31 downto 0); -- 0 to UART_wait_cycles
@@ -52,7 +78,15 @@ signal snd_bit_counter      : unsigned(3 downto 0);  -- 0 to 8
 signal snd_stop_counter     : unsigned(1 downto 0);  -- 0 to 2
 signal snd_parity_bit       : std_logic; -- 0 for even, 1 for odd
 signal snd_data             : unsigned(7 downto 0);
+signal snd_next             : unsigned(7 downto 0); -- fetched in snd_STOP
+signal snd_next_valid       : std_logic;
 signal snd_out              : std_logic := '1'; -- for BLT_Tx
+signal snd_frac_acc         : unsigned(7 downto 0);
+signal snd_extra            : std_logic; -- this bit lasts one more cycle
+signal snd_limit            : unsigned(31 downto 0);
+signal snd_bit_end          : std_logic;
+signal snd_cts              : std_logic_vector(1 downto 0); -- synchronizer
+signal snd_allowed          : std_logic; -- flow control lets a frame start
 
 -- RECEIVE SIGNALS
 signal rcv_state            : UART_rcv_state;
@@ -61,6 +95,34 @@ signal rcv_bit_counter      : unsigned(3 downto 0);  -- 0 to 8
 signal rcv_data             : std_logic_vector(7 downto 0);
 signal rcv_parity_bit       : std_logic; -- 0 for even, 1 for odd
 signal rcv_wrong_parity        : std_logic;
+signal rcv_frac_acc         : unsigned(7 downto 0);
+signal rcv_extra            : std_logic;
+signal rcv_limit            : unsigned(31 downto 0);
+signal rcv_bit_end          : std_logic;
+signal rcv_write            : std_logic;
+signal rcv_writedata        : std_logic_vector(7 downto 0);
+signal rcv_dropped          : std_logic;
+signal rcv_received         : std_logic;
+signal rcv_parity_error     : std_logic;
+
+-- OVERSAMPLING RECEIVE SIGNALS
+signal os_state             : UART_os_state;
+signal os_rx                : std_logic_vector(2 downto 0); -- synchronizer, last
+signal os_period            : unsigned(40 downto 0); -- bit period, 1/256 cycles
+signal os_phase             : unsigned(40 downto 0);
+signal os_tick              : std_logic; -- 16 per bit
+signal os_sub               : unsigned(3 downto 0);  -- tick in the bit
+signal os_ones              : unsigned(1 downto 0);  -- samples at '1'
+signal os_bit               : std_logic; -- majority of the 3 samples
+signal os_bit_counter       : unsigned(3 downto 0);
+signal os_data              : std_logic_vector(7 downto 0);
+signal os_parity_bit        : std_logic;
+signal os_wrong_parity      : std_logic;
+signal os_write             : std_logic;
+signal os_writedata         : std_logic_vector(7 downto 0);
+signal os_dropped           : std_logic;
+signal os_received          : std_logic;
+signal os_parity_error      : std_logic;
 
 signal UART_stop            : unsigned(0 downto 0);
 
@@ -69,6 +131,57 @@ begin
 UART_stop(0)<= UART_stop_bit;
 BLT_Tx      <= snd_out;
 
+-- bit ends, one more cycle when the fraction carried
+snd_limit       <= unsigned(UART_wait_cycles) + 1 when UART_frac_on = '1' and snd_extra = '1'
+              else unsigned(UART_wait_cycles);
+snd_bit_end     <= '1' when snd_state /= snd_WAITING and snd_counter >= snd_limit else '0';
+rcv_limit       <= unsigned(UART_wait_cycles) + 1 when UART_frac_on = '1' and rcv_extra = '1'
+              else unsigned(UART_wait_cycles);
+rcv_bit_end     <= '1' when (rcv_state = rcv_RECEIVING or rcv_state = rcv_PARITY or rcv_state = rcv_STOP)
+                        and rcv_counter >= rcv_limit
+              else '0';
+
+snd_allowed     <= '1' when UART_flow_on = '0' or snd_cts(1) = '0' else '0';
+UART_tx_busy    <= '0' when snd_state = snd_WAITING else '1';
+UART_tx_gap     <= '1' when snd_state = snd_WAITING and UART_on = '1'
+                        and (snd_next_valid = '1' or FIFO_out_empty = '0')
+              else '0';
+
+-- receiver in use
+UART_write          <= os_write     when UART_oversample = '1' else rcv_write;
+UART_writedata      <= os_writedata when UART_oversample = '1' else rcv_writedata;
+UART_data_dropped   <= os_dropped   when UART_oversample = '1' else rcv_dropped;
+UART_data_received  <= os_received  when UART_oversample = '1' else rcv_received;
+UART_parity_error   <= os_parity_error when UART_oversample = '1' else rcv_parity_error;
+
+fractions : process(nReset, clk)
+variable sum : unsigned(8 downto 0);
+begin
+    if(nReset = '0') then
+        snd_frac_acc    <= (others => '0');
+        snd_extra       <= '0';
+        rcv_frac_acc    <= (others => '0');
+        rcv_extra       <= '0';
+    elsif(rising_edge(clk)) then
+        if(UART_frac_on = '0' or snd_state = snd_WAITING) then
+            snd_frac_acc    <= (others => '0');
+            snd_extra       <= '0';
+        elsif(snd_bit_end = '1') then
+            sum             := ('0' & snd_frac_acc) + unsigned('0' & UART_baud_frac);
+            snd_frac_acc    <= sum(7 downto 0);
+            snd_extra       <= sum(8);
+        end if;
+        if(UART_frac_on = '0' or rcv_state = rcv_WAITING or rcv_state = rcv_START) then
+            rcv_frac_acc    <= (others => '0');
+            rcv_extra       <= '0';
+        elsif(rcv_bit_end = '1') then
+            sum             := ('0' & rcv_frac_acc) + unsigned('0' & UART_baud_frac);
+            rcv_frac_acc    <= sum(7 downto 0);
+            rcv_extra       <= sum(8);
+        end if;
+    end if;
+end process fractions;
+
 transmitting : process(nReset, clk)
 begin
     if(nReset = '0') then
@@ -78,83 +191,102 @@ begin
         snd_stop_counter    <= (others => '0');
         snd_parity_bit      <= '0';
         snd_data            <= (others => '0');
+        snd_next            <= (others => '0');
+        snd_next_valid      <= '0';
         snd_out             <= '1';
+        snd_cts             <= (others => '1');
         UART_read           <= '0';
     elsif(rising_edge(clk)) then
         -- default value
         UART_read           <= '0';
+        snd_cts             <= snd_cts(0) & nBLT_CTS;
         -- flip-flops default values
         snd_state           <= snd_state;
         snd_counter         <= snd_counter;
         snd_bit_counter     <= snd_bit_counter;
         snd_stop_counter    <= snd_stop_counter;
         snd_data            <= snd_data;
+        snd_next            <= snd_next;
+        snd_next_valid      <= snd_next_valid;
         snd_out             <= snd_out;
         --parity computation : 0 for even, 1 for odd, xor does the work
         snd_parity_bit      <=  snd_data(0) xor snd_data(1) xor snd_data(2) xor snd_data(3)
                             xor snd_data(4) xor snd_data(5) xor snd_data(6) xor snd_data(7);
+        -- each bit is put on snd_out as the previous one ends, and lasts
+        -- snd_limit+1 cycles
         case snd_state is
         when snd_WAITING =>
             snd_out <= '1';
-            if(UART_on = '1' and FIFO_out_empty = '0') then
-					 snd_data <= unsigned(FIFO_out_readdata);
-					 snd_state <= snd_START;
-					 snd_counter <= (others => '0');
-					 UART_read <= '1';					 
-				else
-                snd_state   <= snd_WAITING;
+            if(UART_on = '1' and snd_allowed = '1' and snd_next_valid = '1') then
+                snd_data        <= snd_next;
+                snd_next_valid  <= '0';
+                snd_out         <= '0';
+                snd_counter     <= (others => '0');
+                snd_state       <= snd_START;
+            elsif(UART_on = '1' and snd_allowed = '1' and FIFO_out_empty = '0') then
+                snd_data        <= unsigned(FIFO_out_readdata);
+                UART_read       <= '1';
+                snd_out         <= '0';
+                snd_counter     <= (others => '0');
+                snd_state       <= snd_START;
             end if;
         when snd_START =>
-            snd_out         <= '0';
-            if(snd_counter >= unsigned(UART_wait_cycles) -1) then
-                snd_state       <= snd_SENDING;
-                snd_bit_counter <= (others => '0');
+            if(snd_counter >= snd_limit) then
+                snd_out         <= snd_data(0);
+                snd_bit_counter <= to_unsigned(1, 4);
                 snd_counter     <= (others => '0');
+                snd_state       <= snd_SENDING;
             else
-                snd_state   <= snd_START;
-                snd_counter <= snd_counter +1;
+                snd_counter     <= snd_counter +1;
             end if;
         when snd_SENDING =>
-            if(snd_bit_counter >= 8 and UART_parity(1)  = '0') then --no parity
+            -- snd_bit_counter is the next data bit
+            if(snd_counter < snd_limit) then
+                snd_counter     <= snd_counter +1;
+            elsif(snd_bit_counter < 8) then
+                snd_out         <= snd_data(to_integer(snd_bit_counter(2 downto 0)));
+                snd_bit_counter <= snd_bit_counter +1;
+                snd_counter     <= (others => '0');
+            elsif(UART_parity(1) = '1') then --parity set
+                --xor between settings and even parity to obtain odd.
+                snd_out         <= snd_parity_bit xor UART_parity(0);
+                snd_counter     <= (others => '0');
+                snd_state       <= snd_PARITY;
+            else --no parity
                 snd_out             <= '1';
                 snd_counter         <= (others => '0');
-                snd_state           <= snd_STOP;
                 snd_stop_counter    <= (others => '0');
-            elsif(snd_bit_counter >= 8) then --parity set
-                snd_out     <= snd_parity_bit xor UART_parity(0);
-                snd_counter <= (others => '0');
-                snd_state   <= snd_PARITY;
-                --xor between settings and even parity to obtain odd.
-            elsif(snd_counter >= unsigned(UART_wait_cycles)) then
-                snd_out         <= snd_data(to_integer(snd_bit_counter));
-                snd_state       <= snd_SENDING;
-                snd_bit_counter <= snd_bit_counter +1;
-                snd_counter     <= (others => '0');
-            else
-                snd_out     <= snd_data(to_integer(snd_bit_counter));
-                snd_state   <= snd_SENDING;
-                snd_counter <= snd_counter +1;
+                snd_state           <= snd_STOP;
             end if;
         when snd_PARITY =>
-            snd_out     <= snd_parity_bit xor UART_parity(0);
-            if(snd_counter >= unsigned(UART_wait_cycles)) then
+            if(snd_counter >= snd_limit) then
+                snd_out             <= '1';
                 snd_counter         <= (others => '0');
-                snd_state           <= snd_STOP;
                 snd_stop_counter    <= (others => '0');
+                snd_state           <= snd_STOP;
             else
                 snd_counter <= snd_counter +1;
-                snd_state   <= snd_PARITY;
             end if;
         when snd_STOP =>
-            snd_out <= '1';
-            snd_state   <= snd_STOP;
-            snd_counter <= snd_counter +1;
-            if(snd_counter >= unsigned(UART_wait_cycles)) then
+            -- prefetch, the next frame starts as the last stop bit ends
+            if(UART_on = '1' and snd_next_valid = '0' and FIFO_out_empty = '0') then
+                snd_next        <= unsigned(FIFO_out_readdata);
+                snd_next_valid  <= '1';
+                UART_read       <= '1';
+            end if;
+            if(snd_counter < snd_limit) then
+                snd_counter         <= snd_counter +1;
+            elsif(snd_stop_counter < UART_stop) then --second stop bit
                 snd_stop_counter    <= snd_stop_counter +1;
                 snd_counter         <= (others => '0');
-                if(snd_stop_counter >= UART_stop)then
-                    snd_state       <= snd_WAITING;
-                end if;
+            elsif(UART_on = '1' and snd_allowed = '1' and snd_next_valid = '1') then
+                snd_data            <= snd_next;
+                snd_next_valid      <= '0';
+                snd_out             <= '0';
+                snd_counter         <= (others => '0');
+                snd_state           <= snd_START;
+            else
+                snd_state           <= snd_WAITING;
             end if;
         end case;
     end if;
@@ -172,9 +304,10 @@ begin
         rcv_counter         <= (others => '0');
         rcv_bit_counter     <= (others => '0');
         rcv_data            <= (others => '0');
-        UART_write          <= '0';
-        UART_writedata      <= (others => '0');
-        UART_data_dropped   <= '0';
+        rcv_write           <= '0';
+        rcv_writedata       <= (others => '0');
+        rcv_dropped         <= '0';
+        rcv_parity_error    <= '0';
         rcv_wrong_parity       <= '0';
     elsif(rising_edge(clk)) then
         rcv_wrong_parity       <= rcv_wrong_parity;
@@ -182,13 +315,14 @@ begin
         rcv_counter         <= rcv_counter;
         rcv_bit_counter     <= rcv_bit_counter;
         rcv_data            <= rcv_data;
-        UART_write          <= '0';
-        UART_writedata      <= rcv_data;
-        UART_data_dropped   <= '0';
-        UART_data_received  <= '0';
+        rcv_write           <= '0';
+        rcv_writedata       <= rcv_data;
+        rcv_dropped         <= '0';
+        rcv_received        <= '0';
+        rcv_parity_error    <= '0';
         case rcv_state is
         when rcv_WAITING =>
-            if(UART_on = '1' and BLT_Rx = '0') then
+            if(UART_on = '1' and UART_oversample = '0' and BLT_Rx = '0') then
                 rcv_state       <= rcv_START;
                 rcv_counter     <= (others => '0');
                 rcv_bit_counter <= (others => '0'); 
@@ -209,7 +343,7 @@ begin
                 rcv_counter <= rcv_counter +1;
             end if;
         when rcv_RECEIVING =>
-            if(rcv_counter >= unsigned(UART_wait_cycles)) then
+            if(rcv_counter >= rcv_limit) then
                 rcv_counter                             <= (others => '0');
                 rcv_data(to_integer(rcv_bit_counter))   <= BLT_Rx;
                 rcv_bit_counter                         <= rcv_bit_counter +1;
@@ -227,7 +361,7 @@ begin
                 rcv_counter <= rcv_counter +1;
             end if;
         when rcv_PARITY =>
-            if(rcv_counter >= unsigned(UART_wait_cycles)) then
+            if(rcv_counter >= rcv_limit) then
                 rcv_state   <= rcv_STOP;
                 rcv_counter <= (others => '0');
                 if(BLT_Rx /= rcv_parity_bit) then
@@ -238,15 +372,16 @@ begin
                 rcv_counter <= rcv_counter +1;
             end if;
         when rcv_STOP =>
-            if(rcv_counter >= unsigned(UART_wait_cycles)) then
+            if(rcv_counter >= rcv_limit) then
                 if(rcv_wrong_parity = '0' and BLT_Rx = '1') then --good data
                     if(FIFO_in_full = '0') then
-                        UART_write          <= '1';
-                        UART_data_received  <= '1';
+                        rcv_write           <= '1';
+                        rcv_received        <= '1';
                     else
-                        UART_data_dropped   <= '1';
+                        rcv_dropped         <= '1';
                     end if;
                 end if;
+                rcv_parity_error    <= rcv_wrong_parity;
                 rcv_wrong_parity    <= '0';
                 rcv_state       <= rcv_RESTART;
                 rcv_counter     <= (others => '0');
@@ -264,6 +399,102 @@ begin
         end case;
     end if;
 end process receiving;
-end;
 
+-- 16 ticks per bit period : os_period = (UART_wait_cycles+1)*256 + fraction,
+-- the phase goes up by 16*256 each cycle.
+os_period       <= unsigned(UART_wait_cycles) * to_unsigned(256, 9)
+                 + unsigned(UART_baud_frac) + 256 when UART_frac_on = '1'
+              else unsigned(UART_wait_cycles) * to_unsigned(256, 9) + 256;
+os_tick         <= '1' when os_phase + 4096 >= os_period else '0';
+os_bit          <= '1' when os_ones >= 2 else '0';
+os_parity_bit   <=  os_data(0) xor os_data(1) xor os_data(2) xor os_data(3)
+                xor os_data(4) xor os_data(5) xor os_data(6) xor os_data(7)
+                xor UART_parity(0);
 
+oversampling : process(nReset, clk)
+begin
+    if(nReset = '0') then
+        os_state        <= os_WAITING;
+        os_rx           <= (others => '1');
+        os_phase        <= (others => '0');
+        os_sub          <= (others => '0');
+        os_ones         <= (others => '0');
+        os_bit_counter  <= (others => '0');
+        os_data         <= (others => '0');
+        os_wrong_parity <= '0';
+        os_write        <= '0';
+        os_writedata    <= (others => '0');
+        os_dropped      <= '0';
+        os_received     <= '0';
+        os_parity_error <= '0';
+    elsif(rising_edge(clk)) then
+        os_rx           <= os_rx(1 downto 0) & BLT_Rx;
+        os_write        <= '0';
+        os_dropped      <= '0';
+        os_received     <= '0';
+        os_parity_error <= '0';
+        if(os_tick = '1') then
+            os_phase    <= os_phase + 4096 - os_period;
+        else
+            os_phase    <= os_phase + 4096;
+        end if;
+        case os_state is
+        when os_WAITING =>
+            -- falling edge : the start bit begins, tick 0
+            if(UART_on = '1' and UART_oversample = '1' and os_rx(2) = '1' and os_rx(1) = '0') then
+                os_state        <= os_START;
+                os_phase        <= (others => '0');
+                os_sub          <= (others => '0');
+                os_ones         <= (others => '0');
+                os_bit_counter  <= (others => '0');
+            end if;
+        when others =>
+            if(os_tick = '1') then
+                os_sub  <= os_sub + 1;
+                if(os_sub >= 6 and os_sub <= 8 and os_rx(1) = '1') then
+                    os_ones <= os_ones + 1;
+                end if;
+                if(os_sub = 9) then -- the 3 samples are in
+                    os_ones <= (others => '0');
+                    case os_state is
+                    when os_START =>
+                        if(os_bit = '1') then --glitch, not a start bit
+                            os_state    <= os_WAITING;
+                        else
+                            os_state    <= os_RECEIVING;
+                        end if;
+                    when os_RECEIVING =>
+                        os_data(to_integer(os_bit_counter(2 downto 0))) <= os_bit;
+                        os_bit_counter  <= os_bit_counter + 1;
+                        if(os_bit_counter >= 7) then
+                            if(UART_parity(1) = '1') then
+                                os_state    <= os_PARITY;
+                            else
+                                os_state    <= os_STOP;
+                            end if;
+                        end if;
+                    when os_PARITY =>
+                        os_state    <= os_STOP;
+                        if(os_bit /= os_parity_bit) then
+                            os_wrong_parity <= '1';
+                        end if;
+                    when others => -- os_STOP, then wait for the next start bit
+                        if(os_wrong_parity = '0' and os_bit = '1') then --good data
+                            os_writedata    <= os_data;
+                            if(FIFO_in_full = '0') then
+                                os_write        <= '1';
+                                os_received     <= '1';
+                            else
+                                os_dropped      <= '1';
+                            end if;
+                        end if;
+                        os_parity_error <= os_wrong_parity;
+                        os_wrong_parity <= '0';
+                        os_state        <= os_WAITING;
+                    end case;
+                end if;
+            end if;
+        end case;
+    end if;
+end process oversampling;
+end;
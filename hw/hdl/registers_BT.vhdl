@@ -18,29 +18,46 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 entity registers_BT is
+    generic(
+        FIFO_OUT_DEPTH_LOG2 : natural range 10 to 14 := 10;
+        FIFO_IN_DEPTH_LOG2  : natural range 10 to 14 := 10
+    );
     port(
         clk                 : in    std_logic;
         nReset              : in    std_logic;
     -- Slave interface
-        as_address          : in    std_logic_vector(2  downto 0);
+        as_address          : in    std_logic_vector(4  downto 0);
         as_read             : in    std_logic;
         as_readdata         : out   std_logic_vector(31 downto 0);
         as_write            : in    std_logic;
         as_writedata        : in    std_logic_vector(31 downto 0);
         as_byteenable       : in    std_logic_vector(3  downto 0);
     -- FIFO_out interface
-        FIFO_out_use_dw     : in    std_logic_vector(9  downto 0);
+        FIFO_out_use_dw     : in    std_logic_vector(FIFO_OUT_DEPTH_LOG2-1 downto 0);
         FIFO_out_full       : in    std_logic;
     -- FIFO_in interface
-        FIFO_in_use_dw      : in    std_logic_vector(9  downto 0);
+        FIFO_in_use_dw      : in    std_logic_vector(FIFO_IN_DEPTH_LOG2-1 downto 0);
         FIFO_in_full        : in    std_logic;
+        FIFO_in_last_count  : in    std_logic_vector(2  downto 0);
+    -- DMA interface
+        DMA_tx_done         : in    std_logic;
+        DMA_rx_done         : in    std_logic;
     -- UART interface
         UART_on             : out   std_logic;
         UART_parity         : out   std_logic_vector(1  downto 0);
         UART_stop_bit       : out   std_logic;
         UART_wait_cycles    : out   std_logic_vector(31 downto 0);
+        UART_frac_on        : out   std_logic;
+        UART_baud_frac      : out   std_logic_vector(7  downto 0);
+        UART_oversample     : out   std_logic;
+        UART_flow_on        : out   std_logic;
+        UART_rx_stop        : out   std_logic; -- FIFO_in at rts_threshold
         UART_data_dropped   : in    std_logic;
         UART_data_received  : in    std_logic;
+        UART_data_sent      : in    std_logic; -- FIFO_out read for a frame
+        UART_parity_error   : in    std_logic;
+        UART_tx_busy        : in    std_logic; -- a frame is on BLT_Tx
+        UART_tx_gap         : in    std_logic; -- a byte waits, BLT_Tx idle
     -- interrupts
         irq                 : out   std_logic
     );
@@ -48,11 +65,34 @@ end entity registers_BT;
 
 architecture rtl of registers_BT is
 signal UART_on_reg          : std_logic;
-signal i_enable             : std_logic_vector(1  downto 0);
+signal i_enable             : std_logic_vector(5  downto 0);
 signal parity_reg           : std_logic_vector(1  downto 0);
 signal stop_bit_reg         : std_logic;
-signal i_pending            : std_logic_vector(1  downto 0);
+signal i_pending            : std_logic_vector(5  downto 0);
 signal UART_wait_cycles_reg : std_logic_vector(31 downto 0);
+signal frac_on_reg          : std_logic;
+signal baud_frac_reg        : std_logic_vector(7  downto 0);
+signal oversample_reg       : std_logic;
+signal flow_on_reg          : std_logic;
+signal rts_threshold_reg    : std_logic_vector(FIFO_IN_DEPTH_LOG2 downto 0);
+signal tx_watermark_reg     : std_logic_vector(FIFO_OUT_DEPTH_LOG2-1 downto 0);
+signal FIFO_out_low         : std_logic;
+signal FIFO_out_low_reg     : std_logic;
+signal rx_watermark_reg     : std_logic_vector(FIFO_IN_DEPTH_LOG2 downto 0);
+signal rx_timeout_reg       : std_logic_vector(15 downto 0);
+signal data_received_d      : std_logic;
+signal idle_cycles          : unsigned(31 downto 0); -- 0 to UART_wait_cycles
+signal idle_bits            : unsigned(15 downto 0);
+signal idle_armed           : std_logic;
+-- link counters, cleared by a write
+signal tx_count             : unsigned(31 downto 0);
+signal rx_count             : unsigned(31 downto 0);
+signal drop_count           : unsigned(31 downto 0);
+signal parity_count         : unsigned(31 downto 0);
+signal FIFO_in_high         : unsigned(FIFO_IN_DEPTH_LOG2 downto 0);
+signal FIFO_out_high        : unsigned(FIFO_OUT_DEPTH_LOG2 downto 0);
+signal tx_busy_count        : unsigned(31 downto 0);
+signal tx_gap_count         : unsigned(31 downto 0);
  
 begin
 
@@ -60,7 +100,16 @@ UART_on             <= UART_on_reg;
 UART_parity         <= parity_reg;
 UART_stop_bit       <= stop_bit_reg;    
 UART_wait_cycles    <= UART_wait_cycles_reg;
-irq                 <= (i_enable(0) and i_pending(0)) or (i_enable(1) and i_pending(1));
+UART_frac_on        <= frac_on_reg;
+UART_baud_frac      <= baud_frac_reg;
+UART_oversample     <= oversample_reg;
+UART_flow_on        <= flow_on_reg;
+UART_rx_stop        <= '1' when unsigned(FIFO_in_full & FIFO_in_use_dw) >= unsigned(rts_threshold_reg) else '0';
+irq                 <= (i_enable(0) and i_pending(0)) or (i_enable(1) and i_pending(1))
+                    or (i_enable(2) and i_pending(2)) or (i_enable(3) and i_pending(3))
+                    or (i_enable(4) and i_pending(4)) or (i_enable(5) and i_pending(5));
+-- FIFO_out level below the watermark, i_tx_low is raised on the rising edge
+FIFO_out_low        <= '1' when FIFO_out_full = '0' and unsigned(FIFO_out_use_dw) < unsigned(tx_watermark_reg) else '0';
 
 update_write : process(clk, nReset)
 begin
@@ -71,6 +120,28 @@ begin
         stop_bit_reg            <= '0';
         i_pending               <= (others => '0');
         UART_wait_cycles_reg    <= (others => '0');
+        frac_on_reg             <= '0';
+        baud_frac_reg           <= (others => '0');
+        oversample_reg          <= '0';
+        flow_on_reg             <= '0';
+        -- room for 16 more bytes once RTS is deasserted
+        rts_threshold_reg       <= std_logic_vector(to_unsigned(2**FIFO_IN_DEPTH_LOG2 - 16, FIFO_IN_DEPTH_LOG2+1));
+        tx_watermark_reg        <= (others => '0');
+        FIFO_out_low_reg        <= '0';
+        rx_watermark_reg        <= (others => '0');
+        rx_timeout_reg          <= (others => '0');
+        data_received_d         <= '0';
+        idle_cycles             <= (others => '0');
+        idle_bits               <= (others => '0');
+        idle_armed              <= '0';
+        tx_count                <= (others => '0');
+        rx_count                <= (others => '0');
+        drop_count              <= (others => '0');
+        parity_count            <= (others => '0');
+        FIFO_in_high            <= (others => '0');
+        FIFO_out_high           <= (others => '0');
+        tx_busy_count           <= (others => '0');
+        tx_gap_count            <= (others => '0');
     elsif(rising_edge(clk)) then
         UART_on_reg             <= UART_on_reg;
         i_enable                <= i_enable;
@@ -78,32 +149,133 @@ begin
         stop_bit_reg            <= stop_bit_reg;
         i_pending               <= i_pending;
         UART_wait_cycles_reg    <= UART_wait_cycles_reg;
+        tx_watermark_reg        <= tx_watermark_reg;
+        FIFO_out_low_reg        <= FIFO_out_low;
+        data_received_d         <= UART_data_received;
+        if(UART_data_sent = '1') then
+            tx_count            <= tx_count + 1;
+        end if;
+        if(UART_data_received = '1') then
+            rx_count            <= rx_count + 1;
+        end if;
         if(UART_data_dropped = '1') then
-            i_pending(1)        <= '1';
+            drop_count          <= drop_count + 1;
+        end if;
+        if(UART_parity_error = '1') then
+            parity_count        <= parity_count + 1;
         end if;
+        -- line utilisation : busy / (busy + gap) while bytes are queued
+        if(UART_tx_busy = '1') then
+            tx_busy_count       <= tx_busy_count + 1;
+        end if;
+        if(UART_tx_gap = '1') then
+            tx_gap_count        <= tx_gap_count + 1;
+        end if;
+        if(unsigned(FIFO_in_full & FIFO_in_use_dw) > FIFO_in_high) then
+            FIFO_in_high        <= unsigned(FIFO_in_full & FIFO_in_use_dw);
+        end if;
+        if(unsigned(FIFO_out_full & FIFO_out_use_dw) > FIFO_out_high) then
+            FIFO_out_high       <= unsigned(FIFO_out_full & FIFO_out_use_dw);
+        end if;
+        -- silence on BLT_Rx, counted in bit times since the last byte
         if(UART_data_received = '1') then
+            idle_cycles         <= (others => '0');
+            idle_bits           <= (others => '0');
+            idle_armed          <= '1';
+        elsif(idle_cycles >= unsigned(UART_wait_cycles_reg)) then
+            idle_cycles         <= (others => '0');
+            if(idle_bits /= x"FFFF") then
+                idle_bits       <= idle_bits + 1;
+            end if;
+        else
+            idle_cycles         <= idle_cycles + 1;
+        end if;
+        if(idle_armed = '1' and unsigned(rx_timeout_reg) /= 0
+                and idle_bits >= unsigned(rx_timeout_reg)) then
+            idle_armed          <= '0';
+            if(FIFO_in_full = '1' or unsigned(FIFO_in_use_dw) /= 0) then
+                i_pending(5)    <= '1';
+            end if;
+        end if;
+        if(DMA_rx_done = '1') then
+            i_pending(4)        <= '1';
+        end if;
+        if(DMA_tx_done = '1') then
+            i_pending(3)        <= '1';
+        end if;
+        if(FIFO_out_low = '1' and FIFO_out_low_reg = '0') then
+            i_pending(2)        <= '1';
+        end if;
+        if(UART_data_dropped = '1') then
+            i_pending(1)        <= '1';
+        end if;
+        -- usedw counts the byte the cycle after UART_data_received
+        if(data_received_d = '1'
+                and unsigned(FIFO_in_full & FIFO_in_use_dw) >= unsigned(rx_watermark_reg)) then
             i_pending(0)        <= '1';
         end if;
         if(as_write = '1') then
             case as_address is
-            when "000" =>
+            when "00000" =>
+                flow_on_reg     <= as_writedata(12);
+                oversample_reg  <= as_writedata(11);
+                frac_on_reg     <= as_writedata(10);
                 parity_reg      <= as_writedata(5 downto 4);
                 stop_bit_reg    <= as_writedata(3);
-                i_enable        <= as_writedata(2 downto 1);
+                i_enable        <= as_writedata(9 downto 6) & as_writedata(2 downto 1);
                 UART_ON_reg     <= as_writedata(0);
-            when "001" =>
+            when "00001" =>
+                if(as_writedata(5) = '0') then
+                    i_pending(5) <= '0';
+                end if;
+                if(as_writedata(4) = '0') then
+                    i_pending(4) <= '0';
+                end if;
+                if(as_writedata(3) = '0') then
+                    i_pending(3) <= '0';
+                end if;
+                if(as_writedata(2) = '0') then
+                    i_pending(2) <= '0';
+                end if;
                 if(as_writedata(1) = '0') then
                     i_pending(1) <= '0';
                 end if;
                 if(as_writedata(0) = '0') then
                     i_pending(0) <= '0';
                 end if;
-            when "010" =>
+            when "00010" =>
                 UART_wait_cycles_reg    <= as_writedata;
-            when "111" =>
+            when "00111" =>
                 if(as_writedata(0) = '1') then --clear i_pending if reset FIFO_in
-                     i_pending <= "00";
+                     i_pending(1 downto 0) <= "00";
+                     i_pending(5)          <= '0';
+                     idle_armed            <= '0';
                  end if;
+            when "01000" =>
+                tx_watermark_reg        <= as_writedata(FIFO_OUT_DEPTH_LOG2-1 downto 0);
+            when "10010" =>
+                rx_watermark_reg        <= as_writedata(FIFO_IN_DEPTH_LOG2 downto 0);
+            when "10011" =>
+                rx_timeout_reg          <= as_writedata(15 downto 0);
+            when "10100" =>
+                baud_frac_reg           <= as_writedata(7 downto 0);
+            when "10101" =>
+                rts_threshold_reg       <= as_writedata(FIFO_IN_DEPTH_LOG2 downto 0);
+            when "10110" =>
+                tx_count                <= (others => '0');
+            when "10111" =>
+                rx_count                <= (others => '0');
+            when "11000" =>
+                drop_count              <= (others => '0');
+            when "11001" =>
+                parity_count            <= (others => '0');
+            when "11010" =>
+                FIFO_in_high            <= (others => '0');
+                FIFO_out_high           <= (others => '0');
+            when "11011" =>
+                tx_busy_count           <= (others => '0');
+            when "11100" =>
+                tx_gap_count            <= (others => '0');
             when others => null;
             end case;
         end if;
@@ -116,20 +288,53 @@ begin
         as_readdata <= (others => '0');
         if(as_read = '1') then
             case as_address is
-            when "000" =>
+            when "00000" =>
+                  as_readdata(12)         <= flow_on_reg;
+                  as_readdata(11)         <= oversample_reg;
+                  as_readdata(10)         <= frac_on_reg;
+                  as_readdata(9 downto 6) <= i_enable(5 downto 2);
                   as_readdata(5 downto 4) <= parity_reg;
                   as_readdata(3)          <= stop_bit_reg;
-                  as_readdata(2 downto 1) <= i_enable;
+                  as_readdata(2 downto 1) <= i_enable(1 downto 0);
                   as_readdata(0)          <= UART_on_reg;
-            when "001" =>
-                  as_readdata(1 downto 0) <= i_pending;
-            when "010" =>
+            when "00001" =>
+                  as_readdata(5 downto 0) <= i_pending;
+            when "00010" =>
                   as_readdata             <= UART_wait_cycles_reg;
-            when "100" =>
-                  as_readdata(9 downto 0) <= (9 downto 0 => not FIFO_out_full) and std_logic_vector((9 downto 0 => '1') - unsigned(FIFO_out_use_dw));
-            when "110" =>
-						as_readdata(10)			<= FIFO_in_full;
-                  as_readdata(9 downto 0) <= FIFO_in_use_dw;
+            when "00100" =>
+                  -- depth - words, full being the MSB of the word count
+                  as_readdata(FIFO_OUT_DEPTH_LOG2 downto 0) <= std_logic_vector(
+                      to_unsigned(2**FIFO_OUT_DEPTH_LOG2, FIFO_OUT_DEPTH_LOG2+1)
+                      - unsigned(FIFO_out_full & FIFO_out_use_dw));
+            when "00110" =>
+                  as_readdata(FIFO_IN_DEPTH_LOG2 downto 0) <= FIFO_in_full & FIFO_in_use_dw;
+                  as_readdata(31 downto 29) <= FIFO_in_last_count;
+            when "01000" =>
+                  as_readdata(FIFO_OUT_DEPTH_LOG2-1 downto 0) <= tx_watermark_reg;
+            when "10010" =>
+                  as_readdata(FIFO_IN_DEPTH_LOG2 downto 0) <= rx_watermark_reg;
+            when "10011" =>
+                  as_readdata(15 downto 0) <= rx_timeout_reg;
+            when "10100" =>
+                  as_readdata(7 downto 0)  <= baud_frac_reg;
+            when "10101" =>
+                  as_readdata(FIFO_IN_DEPTH_LOG2 downto 0) <= rts_threshold_reg;
+            when "10110" =>
+                  as_readdata             <= std_logic_vector(tx_count);
+            when "10111" =>
+                  as_readdata             <= std_logic_vector(rx_count);
+            when "11000" =>
+                  as_readdata             <= std_logic_vector(drop_count);
+            when "11001" =>
+                  as_readdata             <= std_logic_vector(parity_count);
+            when "11010" =>
+                  -- highest levels since the last clear, full being the MSB
+                  as_readdata(FIFO_IN_DEPTH_LOG2 downto 0)       <= std_logic_vector(FIFO_in_high);
+                  as_readdata(16+FIFO_OUT_DEPTH_LOG2 downto 16)  <= std_logic_vector(FIFO_out_high);
+            when "11011" =>
+                  as_readdata             <= std_logic_vector(tx_busy_count);
+            when "11100" =>
+                  as_readdata             <= std_logic_vector(tx_gap_count);
             when others =>
             end case;
         end if;
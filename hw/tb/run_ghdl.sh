@@ -0,0 +1,21 @@
+#!/bin/sh
+# Simulation of HC05_extension with GHDL, no Quartus libraries needed :
+# scfifo.vhd stands for the altera_mf FIFO.
+#
+# usage: hw/tb/run_ghdl.sh [-gMIN_BPS=115200] [-gBYTES=32] [-gFRAC_BAUD=true]
+# the generics of tb_HC05_extension are passed to the run, the CSV goes to
+# the standard output, the first failed check stops the run (exit status not 0).
+set -e
+TB=$(cd "$(dirname "$0")" && pwd)
+HDL="$TB/../hdl"
+WORK="${WORK:-$TB/work}"
+GHDLFLAGS="--std=08 -frelaxed"
+
+mkdir -p "$WORK"
+cd "$WORK"
+ghdl -a $GHDLFLAGS --work=altera_mf "$TB/scfifo.vhd"
+ghdl -a $GHDLFLAGS "$HDL/FIFO_out_BT.vhd" "$HDL/FIFO_in_BT.vhd" \
+	"$HDL/UART_BT.vhdl" "$HDL/DMA_BT.vhdl" "$HDL/registers_BT.vhdl" \
+	"$HDL/HC05_extension.vhd" "$TB/tb_HC05_extension.vhd"
+ghdl -e $GHDLFLAGS tb_HC05_extension
+ghdl -r $GHDLFLAGS tb_HC05_extension "$@"
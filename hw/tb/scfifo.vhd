@@ -0,0 +1,101 @@
+-- #############################################################################
+-- scfifo.vhd
+--
+-- BOARD         : none, simulation only
+-- Revision      : 1.0
+--
+-- Syntax Rule : nGROUP_NAME[bit]
+--
+-- n     : to specify an active-low signal
+-- GROUP : specify the source of the signal (ex: UART, FIFO_in, ...)
+-- NAME  : signal name (ex: write, read, ...)
+-- #############################################################################
+--
+-- Behavioural model of the altera_mf scfifo, for simulators without the
+-- Quartus libraries. Analyzed into the altera_mf library, it lets
+-- FIFO_out_BT.vhd and FIFO_in_BT.vhd be simulated as generated.
+-- Only the features they use are modelled :
+--  - lpm_showahead "ON" : q shows the next word, rdreq acknowledges it,
+--  - lpm_showahead "OFF" : q is the word read, the cycle after its rdreq,
+--  - overflow and underflow checking : wrreq when full and rdreq when empty
+--    are ignored,
+--  - usedw wraps to 0 when full, as the MSB of the count is full.
+-- A written word is visible the cycle after its wrreq (empty falls), the M10K
+-- FIFO of the Cyclone V needs a few cycles more in show-ahead mode.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity scfifo is
+    generic(
+        add_ram_output_register : string  := "OFF";
+        intended_device_family  : string  := "Cyclone V";
+        lpm_numwords            : natural := 1024;
+        lpm_showahead           : string  := "OFF";
+        lpm_type                : string  := "scfifo";
+        lpm_width               : natural := 8;
+        lpm_widthu              : natural := 10;
+        overflow_checking       : string  := "ON";
+        underflow_checking      : string  := "ON";
+        use_eab                 : string  := "ON"
+    );
+    port(
+        aclr    : in    std_logic := '0';
+        clock   : in    std_logic;
+        data    : in    std_logic_vector(lpm_width-1 downto 0);
+        rdreq   : in    std_logic;
+        wrreq   : in    std_logic;
+        empty   : out   std_logic;
+        full    : out   std_logic;
+        q       : out   std_logic_vector(lpm_width-1 downto 0);
+        usedw   : out   std_logic_vector(lpm_widthu-1 downto 0)
+    );
+end entity scfifo;
+
+architecture behaviour of scfifo is
+type memory_t is array(0 to lpm_numwords-1) of std_logic_vector(lpm_width-1 downto 0);
+
+signal memory       : memory_t;
+signal rd_ptr       : natural range 0 to lpm_numwords-1;
+signal wr_ptr       : natural range 0 to lpm_numwords-1;
+signal count        : natural range 0 to lpm_numwords;
+signal q_reg        : std_logic_vector(lpm_width-1 downto 0);
+signal do_read      : std_logic;
+signal do_write     : std_logic;
+
+begin
+
+do_read     <= '1' when rdreq = '1' and count /= 0 else '0';
+do_write    <= '1' when wrreq = '1' and count /= lpm_numwords else '0';
+
+empty       <= '1' when count = 0 else '0';
+full        <= '1' when count = lpm_numwords else '0';
+usedw       <= std_logic_vector(to_unsigned(count mod 2**lpm_widthu, lpm_widthu));
+q           <= memory(rd_ptr) when lpm_showahead = "ON" else q_reg;
+
+storage : process(aclr, clock)
+begin
+    if(aclr = '1') then
+        rd_ptr  <= 0;
+        wr_ptr  <= 0;
+        count   <= 0;
+        q_reg   <= (others => '0');
+    elsif(rising_edge(clock)) then
+        if(do_write = '1') then
+            memory(wr_ptr)  <= data;
+            wr_ptr          <= (wr_ptr + 1) mod lpm_numwords;
+        end if;
+        if(do_read = '1') then
+            q_reg           <= memory(rd_ptr);
+            rd_ptr          <= (rd_ptr + 1) mod lpm_numwords;
+        end if;
+        if(do_write = '1' and do_read = '0') then
+            count   <= count + 1;
+        elsif(do_write = '0' and do_read = '1') then
+            count   <= count - 1;
+        end if;
+    end if;
+end process storage;
+
+end architecture behaviour;
@@ -0,0 +1,413 @@
+-- #############################################################################
+-- tb_HC05_extension.vhd
+--
+-- BOARD         : none, simulation only
+-- Revision      : 1.0
+--
+-- Syntax Rule : nGROUP_NAME[bit]
+--
+-- n     : to specify an active-low signal
+-- GROUP : specify the source of the signal (ex: UART, FIFO_in, ...)
+-- NAME  : signal name (ex: write, read, ...)
+-- #############################################################################
+--
+-- Throughput testbench of HC05_extension, BLT_Tx looped back to BLT_Rx.
+-- For each baud rate (from MIN_BPS), parity and stop bits it drives the
+-- Avalon slave as the Nios does (one access at a time, readdata with the
+-- waitrequest low cycle that accepts the read) :
+--  - BYTES bytes written at "00011", one per access, then read back at
+--    "00101" once received,
+--  - BYTES bytes written 4 per access at "01001", then read back at "01010",
+-- and prints one CSV line :
+--  - bit_cycles, baud_frac, frame_cycles : the configured bit length, its
+--    fraction in 1/256 cycles and the frame length. With FRAC_BAUD the rate
+--    is set with UART_baud_frac, a bit lasting CLK_HZ/baud cycles on
+--    average, otherwise with UART_wait_cycles alone, rounded,
+--  - cycles_per_frame : the measured distance between two start bits of a
+--    burst, idle_cycles the part of it outside of the frame,
+--  - line_pct : frame_cycles / cycles_per_frame,
+--  - wr8, wr32, rd8, rd32 : Avalon cycles per byte of each access type,
+--    waitrequest included,
+--  - read_latency : cycles from as_read to the FIFO_in byte,
+--  - busy, gap : the TX_BUSY_CYCLES and TX_GAP_CYCLES registers after the
+--    first burst.
+-- The data read back, the frame count on BLT_Tx, the frames being back to
+-- back with exactly the bit lengths of the fractional accumulator (a burst
+-- of n bits lasts n*bit_cycles + (n-1)*baud_frac/256 cycles) and the drop
+-- and parity counters are checked, the first mismatch stops the run with a
+-- failure (the CSV lines before it are the configurations that passed).
+-- GHDL : see run_ghdl.sh.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use std.textio.all;
+
+entity tb_HC05_extension is
+    generic(
+        CLK_HZ      : natural   := 50000000;
+        BYTES       : positive  := 16;      -- per run, a multiple of 4
+        MIN_BPS     : natural   := 4800;    -- slower rates are skipped
+        FRAC_BAUD   : boolean   := false    -- UART_baud_frac set and enabled
+    );
+end entity tb_HC05_extension;
+
+architecture bench of tb_HC05_extension is
+type natural_array is array(natural range <>) of natural;
+
+constant CLK_PERIOD         : time := 1 sec / CLK_HZ;
+-- the baud_rate values of baud_rates.h
+constant BPS                : natural_array := (4800, 9600, 19200, 38400,
+    57600, 115200, 230400, 460800, 921600, 1382400);
+
+-- registers, as in hc05.h
+constant REG_CTRL           : natural := 0;
+constant REG_WAIT_CYCLES    : natural := 2;
+constant REG_FIFO_OUT_DATA  : natural := 3;
+constant REG_FIFO_IN_DATA   : natural := 5;
+constant REG_RESET_FIFO     : natural := 7;
+constant REG_FIFO_OUT_DATA32: natural := 9;
+constant REG_FIFO_IN_DATA32 : natural := 10;
+constant REG_BAUD_FRAC      : natural := 20;
+constant REG_RX_COUNT       : natural := 23;
+constant REG_DROP_COUNT     : natural := 24;
+constant REG_PARITY_ERRORS  : natural := 25;
+constant REG_TX_BUSY_CYCLES : natural := 27;
+constant REG_TX_GAP_CYCLES  : natural := 28;
+
+-- byte i of a run, all parities on the line
+function test_byte(i : natural) return std_logic_vector is
+begin
+    return std_logic_vector(to_unsigned((i * 37 + 11) mod 256, 8));
+end function test_byte;
+
+-- tenths as "x.y"
+function fixed1(value : integer) return string is
+begin
+    if(value < 0) then
+        return "-" & fixed1(-value);
+    end if;
+    return integer'image(value / 10) & "." & integer'image(value mod 10);
+end function fixed1;
+
+signal clk              : std_logic := '0';
+signal nReset           : std_logic := '0';
+signal done             : boolean := false;
+signal cycle            : natural := 0;
+
+signal as_address       : std_logic_vector(4  downto 0) := (others => '0');
+signal as_read          : std_logic := '0';
+signal as_readdata      : std_logic_vector(31 downto 0);
+signal as_write         : std_logic := '0';
+signal as_writedata     : std_logic_vector(31 downto 0) := (others => '0');
+signal as_byteenable    : std_logic_vector(3  downto 0) := (others => '1');
+signal as_waitrequest   : std_logic;
+signal BLT_line         : std_logic;
+
+-- BLT_Tx monitor : start bits of the current run
+signal mon_clear        : boolean := false; -- toggled to start a run
+signal mon_bit_cycles   : natural := 1;
+signal mon_frame_bits   : natural := 10;
+signal mon_frames       : natural := 0;
+signal mon_first        : natural := 0;
+signal mon_last         : natural := 0;
+
+begin
+
+clocking : process
+begin
+    while not done loop
+        clk <= '0';
+        wait for CLK_PERIOD / 2;
+        clk <= '1';
+        wait for CLK_PERIOD / 2;
+    end loop;
+    wait;
+end process clocking;
+
+counting : process(clk)
+begin
+    if(rising_edge(clk)) then
+        cycle <= cycle + 1;
+    end if;
+end process counting;
+
+-- a falling edge out of a frame is a start bit, the frame is skipped up to
+-- the middle of its last stop bit
+line_monitor : process
+    variable frames : natural := 0;
+begin
+    wait on BLT_line, mon_clear;
+    if(mon_clear'event) then
+        frames      := 0;
+        mon_frames  <= 0;
+    elsif(BLT_line = '0') then
+        if(frames = 0) then
+            mon_first   <= cycle;
+        end if;
+        frames      := frames + 1;
+        mon_frames  <= frames;
+        mon_last    <= cycle;
+        wait for ((mon_frame_bits - 1) * mon_bit_cycles + mon_bit_cycles / 2) * CLK_PERIOD;
+    end if;
+end process line_monitor;
+
+stimulus : process
+    variable l              : line;
+    variable value          : std_logic_vector(31 downto 0);
+    variable wait_cycles    : natural;
+    variable baud_frac      : natural;
+    variable parity         : std_logic_vector(1 downto 0);
+    variable frame_bits     : natural;
+    variable frame_cycles   : natural;
+    variable frame_x10      : natural;
+    variable timeout        : natural;
+    variable start          : natural;
+    variable latency        : natural;
+    variable per_frame_x10  : natural;
+    variable wr8            : natural;
+    variable wr32           : natural;
+    variable rd8            : natural;
+    variable rd32           : natural;
+    variable busy           : natural;
+    variable gap            : natural;
+
+    -- cycles added by the fractional accumulator to a burst of bits
+    impure function frac_cycles(bits : natural) return natural is
+    begin
+        if(bits = 0) then
+            return 0;
+        end if;
+        return (bits - 1) * baud_frac / 256;
+    end function frac_cycles;
+
+    procedure tick(n : natural) is
+    begin
+        for i in 1 to n loop
+            wait until rising_edge(clk);
+        end loop;
+    end procedure tick;
+
+    -- one write, held while as_waitrequest is high
+    procedure av_write(addr : natural; data : std_logic_vector(31 downto 0);
+                       be : std_logic_vector(3 downto 0) := "1111") is
+    begin
+        as_address      <= std_logic_vector(to_unsigned(addr, 5));
+        as_writedata    <= data;
+        as_byteenable   <= be;
+        as_write        <= '1';
+        wait until rising_edge(clk) and as_waitrequest = '0';
+        as_write        <= '0';
+    end procedure av_write;
+
+    -- one read, readdata sampled in the cycle it is accepted. The address is
+    -- not held after that, as on the Nios bus : a slave still decoding it
+    -- would read X
+    procedure av_read(addr : natural; data : out std_logic_vector(31 downto 0)) is
+    begin
+        as_address      <= std_logic_vector(to_unsigned(addr, 5));
+        as_read         <= '1';
+        wait until rising_edge(clk) and as_waitrequest = '0';
+        data            := as_readdata;
+        as_read         <= '0';
+        as_address      <= (others => 'X');
+    end procedure av_read;
+
+    procedure check(ok : boolean; msg : string) is
+    begin
+        assert ok report msg severity failure;
+    end procedure check;
+
+    -- poll the RX counter until expected bytes came back. The count is up in
+    -- the middle of the first stop bit, the last frame still is on BLT_Tx :
+    -- one more frame lets the line go idle, for the TX counters and before
+    -- the next configuration is written
+    procedure wait_rx(expected : natural; limit : natural) is
+        variable count : std_logic_vector(31 downto 0);
+        variable until_cycle : natural;
+    begin
+        until_cycle := cycle + limit;
+        loop
+            av_read(REG_RX_COUNT, count);
+            exit when to_integer(unsigned(count)) >= expected or cycle >= until_cycle;
+            tick(64);
+        end loop;
+        tick(frame_cycles);
+        check(to_integer(unsigned(count)) = expected, "received "
+            & integer'image(to_integer(unsigned(count))) & " bytes out of "
+            & integer'image(expected));
+    end procedure wait_rx;
+
+begin
+    assert BYTES mod 4 = 0 report "BYTES must be a multiple of 4" severity failure;
+    tick(4);
+    nReset  <= '1';
+    tick(2);
+    write(l, string'("baud,parity,stop_bits,bit_cycles,baud_frac,frame_cycles,cycles_per_frame,"
+        & "idle_cycles,line_pct,wr8,wr32,rd8,rd32,read_latency,busy,gap"));
+    writeline(output, l);
+
+    for r in BPS'range loop
+    if(BPS(r) >= MIN_BPS) then
+        if(FRAC_BAUD) then
+            wait_cycles := CLK_HZ / BPS(r) - 1;
+            baud_frac   := ((CLK_HZ mod BPS(r)) * 256 + BPS(r) / 2) / BPS(r);
+            if(baud_frac = 256) then
+                wait_cycles := wait_cycles + 1;
+                baud_frac   := 0;
+            end if;
+        else
+            wait_cycles := (CLK_HZ + BPS(r) / 2) / BPS(r) - 1;
+            baud_frac   := 0;
+        end if;
+        for p in 0 to 2 loop
+        for s in 0 to 1 loop
+            -- CTRL : UART on, parity none / even / odd, 1 or 2 stop bits
+            case p is
+            when 0      => parity := "00";
+            when 1      => parity := "10";
+            when others => parity := "11";
+            end case;
+            frame_bits      := 10 + s;
+            if(p /= 0) then
+                frame_bits  := frame_bits + 1;
+            end if;
+            frame_cycles    := frame_bits * (wait_cycles + 1);
+            frame_x10       := frame_bits * ((wait_cycles + 1) * 256 + baud_frac) * 10 / 256;
+            timeout         := 2 * (BYTES + 2) * (frame_cycles + frame_bits);
+            value           := (others => '0');
+            value(5 downto 4) := parity;
+            if(s = 1) then
+                value(3)    := '1';
+            end if;
+            if(FRAC_BAUD) then
+                value(10)   := '1';
+            end if;
+            value(0)        := '1';
+            av_write(REG_CTRL, value);
+            av_write(REG_WAIT_CYCLES, std_logic_vector(to_unsigned(wait_cycles, 32)));
+            av_write(REG_BAUD_FRAC, std_logic_vector(to_unsigned(baud_frac, 32)));
+            av_write(REG_RESET_FIFO, x"00000003");
+            av_write(REG_RX_COUNT, x"00000000");
+            av_write(REG_DROP_COUNT, x"00000000");
+            av_write(REG_PARITY_ERRORS, x"00000000");
+            av_write(REG_TX_BUSY_CYCLES, x"00000000");
+            av_write(REG_TX_GAP_CYCLES, x"00000000");
+            mon_bit_cycles  <= wait_cycles + 1;
+            mon_frame_bits  <= frame_bits;
+            mon_clear       <= not mon_clear;
+            tick(1);
+
+            -- one byte per access
+            start := cycle;
+            for i in 0 to BYTES - 1 loop
+                av_write(REG_FIFO_OUT_DATA, x"000000" & test_byte(i));
+            end loop;
+            wr8 := cycle - start;
+            wait_rx(BYTES, timeout);
+            check(mon_frames = BYTES, integer'image(mon_frames) & " frames on BLT_Tx");
+            check(mon_last - mon_first = (BYTES - 1) * frame_cycles
+                + frac_cycles((BYTES - 1) * frame_bits),
+                integer'image(mon_last - mon_first) & " cycles between the first and last start bits");
+            av_read(REG_TX_BUSY_CYCLES, value);
+            busy := to_integer(unsigned(value));
+            av_read(REG_TX_GAP_CYCLES, value);
+            gap := to_integer(unsigned(value));
+            check(busy = BYTES * frame_cycles + frac_cycles(BYTES * frame_bits),
+                integer'image(busy) & " busy cycles");
+            per_frame_x10 := (mon_last - mon_first) * 10 / (BYTES - 1);
+            if(per_frame_x10 = 0) then
+                per_frame_x10 := 1;
+            end if;
+
+            start := cycle;
+            for i in 0 to BYTES - 1 loop
+                av_read(REG_FIFO_IN_DATA, value);
+                if(i = 0) then
+                    latency := cycle - start;
+                end if;
+                check(value(7 downto 0) = test_byte(i), "byte " & integer'image(i)
+                    & " read back wrong");
+            end loop;
+            rd8 := cycle - start;
+
+            -- four bytes per access
+            av_write(REG_RX_COUNT, x"00000000");
+            mon_clear       <= not mon_clear;
+            tick(1);
+            start := cycle;
+            for i in 0 to BYTES / 4 - 1 loop
+                av_write(REG_FIFO_OUT_DATA32, test_byte(4*i+3) & test_byte(4*i+2)
+                    & test_byte(4*i+1) & test_byte(4*i));
+            end loop;
+            wr32 := cycle - start;
+            wait_rx(BYTES, timeout);
+            check(mon_frames = BYTES, integer'image(mon_frames) & " frames on BLT_Tx");
+
+            start := cycle;
+            for i in 0 to BYTES / 4 - 1 loop
+                av_read(REG_FIFO_IN_DATA32, value);
+                check(value = test_byte(4*i+3) & test_byte(4*i+2) & test_byte(4*i+1)
+                    & test_byte(4*i), "word " & integer'image(i) & " read back wrong");
+            end loop;
+            rd32 := cycle - start;
+
+            av_read(REG_DROP_COUNT, value);
+            check(unsigned(value) = 0, "bytes dropped");
+            av_read(REG_PARITY_ERRORS, value);
+            check(unsigned(value) = 0, "parity errors");
+
+            write(l, integer'image(BPS(r)) & ",");
+            case p is
+            when 0      => write(l, string'("none,"));
+            when 1      => write(l, string'("even,"));
+            when others => write(l, string'("odd,"));
+            end case;
+            write(l, integer'image(s + 1) & "," & integer'image(wait_cycles + 1) & ","
+                & integer'image(baud_frac) & "," & fixed1(frame_x10) & ","
+                & fixed1(per_frame_x10) & ","
+                & fixed1(per_frame_x10 - frame_x10) & ","
+                & fixed1(frame_x10 * 1000 / per_frame_x10) & ","
+                & fixed1(wr8 * 10 / BYTES) & "," & fixed1(wr32 * 10 / BYTES) & ","
+                & fixed1(rd8 * 10 / BYTES) & "," & fixed1(rd32 * 10 / BYTES) & ","
+                & integer'image(latency) & "," & integer'image(busy) & ","
+                & integer'image(gap));
+            writeline(output, l);
+        end loop;
+        end loop;
+    end if;
+    end loop;
+
+    report "all configurations passed" severity note;
+    done <= true;
+    wait;
+end process stimulus;
+
+-- BLT_Tx looped back to BLT_Rx, the DMA masters never used
+dut : entity work.HC05_extension PORT MAP (
+    clk                 => clk,
+    nReset              => nReset,
+    as_address          => as_address,
+    as_read             => as_read,
+    as_readdata         => as_readdata,
+    as_write            => as_write,
+    as_writedata        => as_writedata,
+    as_byteenable       => as_byteenable,
+    as_waitrequest      => as_waitrequest,
+    am_tx_address       => open,
+    am_tx_read          => open,
+    am_tx_readdata      => (others => '0'),
+    am_tx_waitrequest   => '0',
+    am_rx_address       => open,
+    am_rx_write         => open,
+    am_rx_writedata     => open,
+    am_rx_byteenable    => open,
+    am_rx_waitrequest   => '0',
+    BLT_Rx              => BLT_line,
+    BLT_Tx              => BLT_line,
+    nBLT_RTS            => open,
+    nBLT_CTS            => '0',
+    irq                 => open
+    );
+
+end architecture bench;
@@ -3,21 +3,40 @@
 
 
 /**
- * These baud rates are computed for a 50MHz clock.
- * The value is the amount of clock cycles for each bit.
+ * Clock of the HC05 extension, 50MHz unless the build sets another one
+ * (e.g. -DBT_CLK_HZ=100000000 for a faster fabric clock).
+ */
+#ifndef BT_CLK_HZ
+#define BT_CLK_HZ 50000000
+#endif
+
+/**
+ * The value is the amount of clock cycles for each bit, minus one :
+ * the UART holds each bit for wait_cycles+1 cycles.
  *
  * They are computed with the following formula :
- * wait_cycles 	= time_per_bit / time_per_cycles
- * 				= (1/target_baud_rate)/clk_period
- * 				= clk_freq/target_baud_rate.
- * For example, for a target_baud_rate of 38400 b/s,
- * we have : wait_cycles = 50M/38400 = 1302.08 clk_cycles
+ * wait_cycles 	= time_per_bit / time_per_cycles - 1
+ * 				= (1/target_baud_rate)/clk_period - 1
+ * 				= clk_freq/target_baud_rate - 1, rounded to the nearest.
+ * For example, for a target_baud_rate of 38400 b/s at 50MHz,
+ * we have : wait_cycles = 50M/38400 - 1 = 1301.08 clk_cycles
+ *
+ * BT_BAUD_CYCLES is a constant expression, for tables at any clock.
  */
+#define BT_BAUD_CYCLES(CLK_HZ, BPS) \
+	((((CLK_HZ) + (BPS) / 2) / (BPS)) - 1)
+
 typedef enum {
-	b4800=10415, b9600=5208, b19200=2604,
-	b38400=1302, b57600=867, b115200=433,
-	b230400=216, b460800=109, b921600=53,
-	b1382400=35} baud_rate;
+	b4800=BT_BAUD_CYCLES(BT_CLK_HZ, 4800),
+	b9600=BT_BAUD_CYCLES(BT_CLK_HZ, 9600),
+	b19200=BT_BAUD_CYCLES(BT_CLK_HZ, 19200),
+	b38400=BT_BAUD_CYCLES(BT_CLK_HZ, 38400),
+	b57600=BT_BAUD_CYCLES(BT_CLK_HZ, 57600),
+	b115200=BT_BAUD_CYCLES(BT_CLK_HZ, 115200),
+	b230400=BT_BAUD_CYCLES(BT_CLK_HZ, 230400),
+	b460800=BT_BAUD_CYCLES(BT_CLK_HZ, 460800),
+	b921600=BT_BAUD_CYCLES(BT_CLK_HZ, 921600),
+	b1382400=BT_BAUD_CYCLES(BT_CLK_HZ, 1382400)} baud_rate;
 
 
 #endif /* BAUD_RATES_H_ */
@@ -0,0 +1,160 @@
+#include <string.h>
+#include <inttypes.h>
+
+#include "delta_rle.h"
+
+/*
+ * Initialize an encoder, the previous frame is cleared.
+ * name: delta_rle_enc_init
+ * @param enc  : The encoder,
+ *        prev : storage for the previous frame, size samples,
+ *        size : the number of samples per frame.
+ * @return void
+ *
+ * example: static uint16_t prev[80*60]; delta_rle_enc enc;
+ * delta_rle_enc_init(&enc, prev, 80*60);
+ */
+void delta_rle_enc_init(delta_rle_enc *enc, uint16_t *prev, uint32_t size) {
+	memset(prev, 0, size * sizeof(uint16_t));
+	enc->prev = prev;
+	enc->size = size;
+	enc->pos = 0;
+	enc->run = 0;
+}
+
+static uint32_t put_run(delta_rle_enc *enc, uint8_t *out) {
+	if(enc->run == 0) {
+		return 0;
+	}
+	out[0] = DELTA_RLE_RUN | (enc->run - 1);
+	enc->run = 0;
+	return 1;
+}
+
+/*
+ * Encode the next samples of the current frame. Can be called with any
+ * number of samples (e.g. one row at a time), the frame ends after size
+ * samples and the next call starts a new one.
+ * name: delta_rle_encode
+ * @param enc     : The encoder,
+ *        samples : the samples to encode,
+ *        n       : the number of samples,
+ *        out     : the output, at least DELTA_RLE_MAX_OUT(n) bytes.
+ * @return the number of bytes written to out.
+ *
+ * example: uint8_t out[DELTA_RLE_MAX_OUT(80)];
+ * uint32_t length = delta_rle_encode(&enc, row, 80, out);
+ */
+uint32_t delta_rle_encode(delta_rle_enc *enc, const uint16_t *samples,
+		uint32_t n, uint8_t *out) {
+	uint32_t w = 0;
+	for(uint32_t i = 0; i < n; ++i) {
+		uint16_t cur = samples[i];
+		int32_t delta = (int32_t)cur - enc->prev[enc->pos];
+		enc->prev[enc->pos] = cur;
+		if(delta == 0) {
+			if(++enc->run == 128) { //longest run, keeps the output bounded
+				w += put_run(enc, out + w);
+			}
+		} else {
+			w += put_run(enc, out + w);
+			if(delta >= -32 && delta < 32) {
+				out[w++] = DELTA_RLE_SMALL | (delta & 0x3f);
+			} else if(delta >= -4096 && delta < 4096) {
+				out[w++] = DELTA_RLE_MEDIUM | ((delta >> 8) & 0x1f);
+				out[w++] = delta & 0xff;
+			} else {
+				out[w++] = DELTA_RLE_LITERAL;
+				out[w++] = cur >> 8;
+				out[w++] = cur & 0xff;
+			}
+		}
+		if(++enc->pos == enc->size) { //end of frame
+			w += put_run(enc, out + w);
+			enc->pos = 0;
+		}
+	}
+	return w;
+}
+
+/*
+ * Record samples sent without coding (key frame), so that the next frame is
+ * coded against them.
+ * name: delta_rle_keyframe
+ * @param enc     : The encoder,
+ *        samples : the samples sent,
+ *        n       : the number of samples.
+ * @return void
+ */
+void delta_rle_keyframe(delta_rle_enc *enc, const uint16_t *samples, uint32_t n) {
+	for(uint32_t i = 0; i < n; ++i) {
+		enc->prev[enc->pos] = samples[i];
+		if(++enc->pos == enc->size) {
+			enc->pos = 0;
+		}
+	}
+}
+
+/*
+ * Initialize a decoder.
+ * name: delta_rle_dec_init
+ * @param dec   : The decoder,
+ *        frame : storage for the frame, size samples. It holds the previous
+ *                frame (e.g. a key frame copied there) and is updated in place,
+ *        size  : the number of samples per frame.
+ * @return void
+ */
+void delta_rle_dec_init(delta_rle_dec *dec, uint16_t *frame, uint32_t size) {
+	dec->frame = frame;
+	dec->size = size;
+	dec->pos = 0;
+	dec->have = 0;
+}
+
+/*
+ * Decode one byte of the stream.
+ * name: delta_rle_decode
+ * @param dec  : The decoder,
+ *        byte : the next byte received.
+ * @return 1 when the frame is complete, 0 if more bytes are needed
+ *          or -1 if the stream is corrupted (the decoder is reset).
+ *
+ * example: while(delta_rle_decode(&dec, get_byte()) == 0);
+ * dec.frame holds the new frame.
+ */
+int delta_rle_decode(delta_rle_dec *dec, uint8_t byte) {
+	uint8_t *t = dec->token;
+	t[dec->have++] = byte;
+	if((t[0] & 0x80) == DELTA_RLE_RUN) {
+		dec->pos += (t[0] & 0x7f) + 1;
+		if(dec->pos > dec->size) {
+			dec->pos = 0;
+			dec->have = 0;
+			return -1;
+		}
+	} else if((t[0] & 0xc0) == DELTA_RLE_SMALL) {
+		int32_t delta = (int32_t)((t[0] & 0x3f) ^ 0x20) - 0x20;
+		dec->frame[dec->pos++] += delta;
+	} else if((t[0] & 0xe0) == DELTA_RLE_MEDIUM) {
+		if(dec->have < 2) {
+			return 0;
+		}
+		int32_t delta = (int32_t)((((t[0] & 0x1f) << 8) | t[1]) ^ 0x1000) - 0x1000;
+		dec->frame[dec->pos++] += delta;
+	} else if(t[0] == DELTA_RLE_LITERAL) {
+		if(dec->have < 3) {
+			return 0;
+		}
+		dec->frame[dec->pos++] = (t[1] << 8) | t[2];
+	} else {
+		dec->pos = 0;
+		dec->have = 0;
+		return -1;
+	}
+	dec->have = 0;
+	if(dec->pos == dec->size) {
+		dec->pos = 0;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef DELTA_RLE_H_
+#define DELTA_RLE_H_
+
+#include <stdint.h>
+
+/*
+ * Frame to frame delta + run-length coding of 16-bit samples (Lepton pixels).
+ *
+ * Each pixel is coded as the difference with the same pixel of the previous
+ * frame, runs of unchanged pixels are merged. Tokens are byte aligned :
+ *   0xxxxxxx                   : x+1 unchanged pixels (1 to 128)
+ *   10xxxxxx                   : delta x, 6 bits signed (-32 to 31)
+ *   110xxxxx xxxxxxxx          : delta x, 13 bits signed (-4096 to 4095)
+ *   11100000 hhhhhhhh llllllll : new value 0xhhll
+ * A frame ends after exactly size pixels, runs never cross frames.
+ *
+ * The encoder only keeps the previous frame (size samples, given by the user)
+ * and writes at most DELTA_RLE_MAX_OUT(n) bytes for n pixels.
+ */
+
+#define DELTA_RLE_MAX_OUT(n) (3 * (n) + 1)
+
+#define DELTA_RLE_RUN 0x00
+#define DELTA_RLE_SMALL 0x80
+#define DELTA_RLE_MEDIUM 0xc0
+#define DELTA_RLE_LITERAL 0xe0
+
+/* encoder state */
+typedef struct {
+    uint16_t *prev; /* Previous frame, size samples */
+    uint32_t size;  /* Samples per frame */
+    uint32_t pos;   /* Next sample of the frame */
+    uint32_t run;   /* Unchanged samples not written yet */
+} delta_rle_enc;
+
+/* decoder state */
+typedef struct {
+    uint16_t *frame;    /* Previous frame, then current one, size samples */
+    uint32_t size;      /* Samples per frame */
+    uint32_t pos;       /* Next sample of the frame */
+    uint8_t token[3];   /* Token being received */
+    uint8_t have;       /* Bytes of token received */
+} delta_rle_dec;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+void delta_rle_enc_init(delta_rle_enc *enc, uint16_t *prev, uint32_t size);
+
+uint32_t delta_rle_encode(delta_rle_enc *enc, const uint16_t *samples,
+        uint32_t n, uint8_t *out);
+
+void delta_rle_keyframe(delta_rle_enc *enc, const uint16_t *samples, uint32_t n);
+
+void delta_rle_dec_init(delta_rle_dec *dec, uint16_t *frame, uint32_t size);
+
+int delta_rle_decode(delta_rle_dec *dec, uint8_t byte);
+
+#endif /* DELTA_RLE_H_ */
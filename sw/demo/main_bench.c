@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "system.h"
+#include "sys/alt_timestamp.h"
+#include "ressources/hc05.h"
+#include "ressources/hc05_at.h"
+#include "ressources/hc05_baud.h"
+#include "ressources/hc05_bench.h"
+#include "ressources/i2c_pio.h"
+
+#define BENCH_BYTES 4096
+
+/*
+ * Move the module to rate and ctrl : AT+UART with the KEY pin high, then
+ * AT+RESET and wait for the PC to connect again.
+ */
+static int module_to(hc05_dev *dev, void *arg, baud_rate rate, uint32_t ctrl) {
+	i2c_pio_dev *pio = arg;
+	char cmd[32];
+	int parity = 0;
+	if((ctrl & BLT_PARTITY_MASK) == BLT_ODD_PARITY) {
+		parity = 1;
+	} else if((ctrl & BLT_PARTITY_MASK) == BLT_EVEN_PARITY) {
+		parity = 2;
+	}
+	snprintf(cmd, sizeof(cmd), "AT+UART=%" PRIu32 ",%d,%d", BT_baud_bps(rate),
+		(ctrl & BLT_STOP_MASK) == BLT_STOP_1, parity);
+	i2c_pio_writebit(pio, BIT_BLT_ATSel, 1);
+	if(BT_at_command(dev, cmd, 1000000, NULL) != 0) {
+		i2c_pio_writebit(pio, BIT_BLT_ATSel, 0);
+		return -1;
+	}
+	i2c_pio_writebit(pio, BIT_BLT_ATSel, 0);
+	//the parity and stop bits of the extension follow in BT_bench_config
+	return BT_reconnect(dev, rate, 30000000) == -1 ? -1 : 0;
+}
+
+/**
+ * Benchmark, against a PC echoing every byte it gets on the SPP port
+ * (e.g. socat /dev/rfcomm0,raw,echo=0 exec:cat). The CSV goes to the JTAG UART.
+ */
+int main() {
+	static char tx[BENCH_BYTES];
+	static char rx[BENCH_BYTES];
+	hc05_dev hc05 = hc05_inst(HC05_0_BASE);
+	i2c_pio_dev pio = i2c_pio_inst(I2C_PIO_0_BASE);
+
+	if(alt_timestamp_start() < 0) {
+		printf("no timestamp timer\n");
+		return -1;
+	}
+	i2c_pio_write(&pio, 0);
+	i2c_pio_writebit(&pio, BIT_BLT_PWR, 1);
+	i2c_pio_writebit(&pio, BIT_BLT_EN, 1);
+
+	BT_reset_FIFO(&hc05, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
+	BT_set_CTRL(&hc05, BLT_UART_ON | BLT_STOP_0 | BLT_NO_PARITY);
+	BT_set_baud_rate(&hc05, b115200);
+	if(BT_wait_link(&hc05, 30000000) == -1) {
+		printf("no link after 30s\n");
+		return -1;
+	}
+	for(uint32_t i = 0; i < sizeof(tx); ++i) {
+		tx[i] = i * 7 + 1;
+	}
+
+	hc05_bench bench;
+	BT_bench_init(&bench, &hc05, tx, rx, sizeof(tx));
+	bench.apply = module_to;
+	bench.arg = &pio;
+	int skipped = BT_bench_run(&bench, stdout);
+	printf("%d configurations skipped\n", skipped);
+	//back to the rate of the other demos
+	module_to(&hc05, &pio, b115200, BLT_NO_PARITY | BLT_STOP_0);
+	return 0;
+}
@@ -9,6 +9,8 @@
 #include "io.h"
 #include "system.h"
 #include "ressources/hc05.h"
+#include "ressources/hc05_at.h"
+#include "ressources/hc05_frame.h"
 #include "ressources/i2c_pio.h"
 #include "ressources/mcp3204.h"
 #include "ressources/ws2812.h"
@@ -33,64 +35,47 @@ int main() {
 	i2c_pio_writebit(&pio, BIT_BLT_PWR, 1);
 	i2c_pio_writebit(&pio, BIT_BLT_ATSel, 1);
 
-	usleep(1000000); //1s to let ATSel propagate, really needed?
-
+	//the KEY pin is high once the I2C write returns, before the module boots
 	i2c_pio_writebit(&pio, BIT_BLT_EN, 1);
 
-	usleep(1000000); //1s to let the device boot, needed
 	BT_reset_FIFO(&hc05, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
 	BT_set_CTRL(&hc05, BLT_UART_ON | BLT_STOP_0);
 	BT_set_baud_rate(&hc05, b38400);
-
-	char response[100];
-
-	BT_send_command(&hc05, "AT+UART=115200,0,0", 18);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
+	int boot_us = BT_wait_ready(&hc05, 2000000);
+	if(boot_us == -1) {
+		printf("HC05 not answering\n");
 		return -1;
 	}
 
-	BT_send_command(&hc05, "AT+CMODE=0", 10);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
-		return -1;
-	}
-	BT_send_command(&hc05, "AT+ROLE=1", 9);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
-		return -1;
-	}
-
-	//currently +ADDR:98d3:32:707966
-	BT_send_command(&hc05, "AT+BIND=98d3,32,707966", 22);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
+	bt_at_engine at;
+	bt_at_cmd setup[] = {
+		{"AT+UART=115200,0,0"}, {"AT+CMODE=0"}, {"AT+ROLE=1"},
+		//currently +ADDR:98d3:32:707966
+		{"AT+BIND=98d3,32,707966"}
+	};
+	//sent ahead of the answers, the module answers them in order
+	BT_at_init(&at, &hc05, 4);
+	if(BT_at_run(&at, setup, sizeof(setup) / sizeof(setup[0])) != BT_AT_DONE) {
+		printf("%s command not ok\n", setup[at.done].cmd);
 		return -1;
 	}
+	uint32_t setup_us = BT_at_elapsed_us(&at);
 	i2c_pio_writebit(&pio, BIT_BLT_ATSel, 0);
-	BT_send_command(&hc05, "AT+RESET", 8);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
+	//the slave only listens, the link shows up as the first frames get through
+	if(BT_reconnect(&hc05, b115200, 0) == -1) {
+		printf("AT+RESET command not ok\n");
 		return -1;
 	}
-	//i2c_pio_writebit(&pio, BIT_BLT_EN, 0);
-	//i2c_pio_writebit(&pio, BIT_BLT_EN, 1);
-
-
-	BT_reset_FIFO(&hc05, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
-	BT_set_baud_rate(&hc05, b115200);
+	printf("module ready in %d us, AT setup done in %" PRIu32 " us\n", boot_us,
+		setup_us);
 
 	printf("PRESS RIGHT JOY TO START, LEFT TO PAUSE, BOTH TO STOP\n");
 	printf("LEFT-JOY Y AXIS for BLUE\nRIGHT-JOY Y AXIS for RED\nRIGHT-JOY X AXIS for GREEN\n");
 	printf("y=0 is up, y=255 is down, x=0 is left, x=255 is right\n");
 	fflush(stdout);
 
-	char message[100];
+	bt_link link;
+	BT_link_init(&link, &hc05);
 	int loop = 1;
 	int stop = 1;
 	while(loop) {
@@ -99,16 +84,16 @@ int main() {
 			i2c_pio_writebit(&pio, BIT_J0SWRn, 1);
 			i2c_pio_writebit(&pio, BIT_J1SWRn, 1);
 			if(!i2c_pio_readbit(&pio, BIT_J1SWRn) && !i2c_pio_readbit(&pio, BIT_J0SWRn)) {
-				BT_send_message(&hc05, "OFF\r\n", 5);
+				BT_frame_send(&link, "O", 1);
 				loop = 0;
 			} else if(!i2c_pio_readbit(&pio, BIT_J1SWRn)){
-				BT_send_message(&hc05, "START\r\n", 7);
+				BT_frame_send(&link, "S", 1);
 				stop = 0;
 			}
 		} else {
 			i2c_pio_writebit(&pio, BIT_J0SWRn, 1);
 			if(!i2c_pio_readbit(&pio, BIT_J0SWRn)) { //joy 0 pressed
-				BT_send_message(&hc05, "STOP\r\n", 6);
+				BT_frame_send(&link, "P", 1);
 				stop = 1;
 			}
 			//we shift by 4 on the left to get values
@@ -116,15 +101,9 @@ int main() {
 			uint32_t r = mcp3204_read(&mcp, 0) >> 4;
 			uint32_t g = mcp3204_read(&mcp, 1) >> 4;
 			uint32_t b = mcp3204_read(&mcp, 2) >> 4;
-			//send red
-			sprintf(message, "R%" PRIu32 "\r\n", r);
-			BT_send_message(&hc05, message, strnlen(message, 100));
-			//send green
-			sprintf(message, "G%" PRIu32 "\r\n", g);
-			BT_send_message(&hc05, message, strnlen(message, 100));
-			//send blue
-			sprintf(message, "B%" PRIu32 "\r\n", b);
-			BT_send_message(&hc05, message, strnlen(message, 100));
+			//send red, green and blue in one frame
+			char color[4] = {'C', r, g, b};
+			BT_frame_send(&link, color, 4);
 		}
 	}
 	printf("DONE");
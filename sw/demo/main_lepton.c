@@ -8,7 +8,11 @@
 
 #include "io.h"
 #include "system.h"
+#include "sys/alt_irq.h"
+#include "sys/alt_timestamp.h"
 #include "ressources/hc05.h"
+#include "ressources/hc05_at.h"
+#include "ressources/delta_rle.h"
 #include "ressources/i2c_pio.h"
 #include "ressources/lepton.h"
 #include "ressources/lepton_regs.h"
@@ -24,41 +28,181 @@ void lepton_send_capture(lepton_dev *dev, hc05_dev *hc05, bool adjusted) {
         max_value = 0x3fff;
     }
 
-    char str[1000];
+    char str[32];
+    char line[2 + 80 * 6]; /* '\n', up to 5 digits and a space per pixel, '\0' */
+    uint32_t length;
     int check;
 
     /* Write header */
     sprintf(str, "P2\n%" PRIu8 " %" PRIu8 "\n%" PRIu16, num_cols, num_rows, max_value);
     do {
-    	check = BT_send_message(hc05, str, strnlen(str, 1000));
+    	check = BT_tx_enqueue(hc05, str, strnlen(str, 32));
     } while(check == -1);
-    /* Write body */
+    /* Write body, one row formatted at a time and queued whole */
     uint8_t row = 0;
     for (row = 0; row < num_rows; ++row) {
-    	do {
-    		check = BT_send_word_safe(hc05, '\n');
-    	} while(check == -1);
+        length = 0;
+        line[length++] = '\n';
         uint8_t col = 0;
         for (col = 0; col < num_cols; ++col) {
-            if (col > 0) {
-            	do {
-					check = BT_send_word_safe(hc05, ' ');
-				} while(check == -1);
-            }
+            uint16_t current_ofst = offset + (row * num_cols + col) * sizeof(uint16_t);
+            uint16_t pix_value = IORD_16DIRECT(dev->base, current_ofst);
+            length += sprintf(line + length, col > 0 ? " %" PRIu16 : "%" PRIu16, pix_value);
+        }
+        do {
+        	check = BT_tx_enqueue(hc05, line, length);
+        } while(check == -1);
+    }
+}
 
+/*
+ * Send a frame as binary PGM (P5) : same header as the ASCII version, then
+ * the 16-bit pixels big-endian (maxval > 255), 2 bytes per pixel instead of
+ * up to 6 characters. One row is converted at a time and queued whole.
+ */
+void lepton_send_capture_binary(lepton_dev *dev, hc05_dev *hc05, bool adjusted) {
+    const uint8_t num_rows = 60;
+    const uint8_t num_cols = 80;
+
+    uint16_t offset = LEPTON_REGS_BUFFER_OFST;
+    uint16_t max_value = IORD_16DIRECT(dev->base, LEPTON_REGS_MAX_OFST);
+    if (adjusted) {
+        offset = LEPTON_REGS_ADJUSTED_BUFFER_OFST;
+        max_value = 0x3fff;
+    }
+
+    char str[32];
+    uint8_t line[80 * sizeof(uint16_t)];
+    int check;
+
+    /* Write header */
+    sprintf(str, "P5\n%" PRIu8 " %" PRIu8 "\n%" PRIu16 "\n", num_cols, num_rows, max_value);
+    do {
+    	check = BT_tx_enqueue(hc05, str, strnlen(str, 32));
+    } while(check == -1);
+    /* Write body */
+    uint8_t row = 0;
+    for (row = 0; row < num_rows; ++row) {
+        uint8_t col = 0;
+        for (col = 0; col < num_cols; ++col) {
             uint16_t current_ofst = offset + (row * num_cols + col) * sizeof(uint16_t);
             uint16_t pix_value = IORD_16DIRECT(dev->base, current_ofst);
-            sprintf(str, "%" PRIu16, pix_value);
-            do {
-				check = BT_send_message(hc05, str, strnlen(str, 1000));
-			} while(check == -1);
+            line[2 * col] = pix_value >> 8;
+            line[2 * col + 1] = pix_value & 0xff;
+        }
+        do {
+        	check = BT_tx_enqueue(hc05, (char *) line, sizeof(line));
+        } while(check == -1);
+    }
+}
+
+/*
+ * Send a frame as binary PGM (P5) with the TX DMA channel : the whole frame is
+ * built in dma_frame, then the extension sends it while the CPU goes on (the
+ * next capture, ...). Waits for the transmit queue and the previous DMA
+ * transfer, the bytes would be interleaved otherwise.
+ */
+static uint8_t dma_frame[32 + 80 * 60 * sizeof(uint16_t)];
+
+void lepton_send_capture_dma(lepton_dev *dev, hc05_dev *hc05, bool adjusted) {
+    const uint8_t num_rows = 60;
+    const uint8_t num_cols = 80;
+
+    uint16_t offset = LEPTON_REGS_BUFFER_OFST;
+    uint16_t max_value = IORD_16DIRECT(dev->base, LEPTON_REGS_MAX_OFST);
+    if (adjusted) {
+        offset = LEPTON_REGS_ADJUSTED_BUFFER_OFST;
+        max_value = 0x3fff;
+    }
+
+    while(BT_tx_pending(hc05) != 0 || BT_dma_tx_left(hc05) != 0);
+    /* Write header */
+    uint32_t length = sprintf((char *) dma_frame, "P5\n%" PRIu8 " %" PRIu8 "\n%" PRIu16 "\n",
+        num_cols, num_rows, max_value);
+    /* Write body */
+    uint16_t i;
+    for (i = 0; i < num_rows * num_cols; ++i) {
+        uint16_t pix_value = IORD_16DIRECT(dev->base, offset + i * sizeof(uint16_t));
+        dma_frame[length++] = pix_value >> 8;
+        dma_frame[length++] = pix_value & 0xff;
+    }
+    BT_send_dma(hc05, dma_frame, length);
+}
+
+/*
+ * Send a frame coded against the previous one (see delta_rle.h) :
+ * "D5" header, same fields as P5, then the tokens of the 80x60 pixels.
+ * Key frames are sent as P5 and recorded by the encoder, the receiver needs
+ * one to start and resynchronizes on the next one after an error.
+ */
+void lepton_send_capture_delta(lepton_dev *dev, hc05_dev *hc05, bool adjusted,
+        delta_rle_enc *enc, bool keyframe) {
+    const uint8_t num_rows = 60;
+    const uint8_t num_cols = 80;
+
+    uint16_t offset = LEPTON_REGS_BUFFER_OFST;
+    uint16_t max_value = IORD_16DIRECT(dev->base, LEPTON_REGS_MAX_OFST);
+    if (adjusted) {
+        offset = LEPTON_REGS_ADJUSTED_BUFFER_OFST;
+        max_value = 0x3fff;
+    }
+
+    char str[32];
+    uint16_t pixels[80];
+    uint8_t line[DELTA_RLE_MAX_OUT(80)];
+    uint32_t length;
+    int check;
+
+    /* Write header */
+    sprintf(str, "%c5\n%" PRIu8 " %" PRIu8 "\n%" PRIu16 "\n", keyframe ? 'P' : 'D',
+            num_cols, num_rows, max_value);
+    do {
+    	check = BT_tx_enqueue(hc05, str, strnlen(str, 32));
+    } while(check == -1);
+    /* Write body */
+    uint8_t row = 0;
+    for (row = 0; row < num_rows; ++row) {
+        uint8_t col = 0;
+        for (col = 0; col < num_cols; ++col) {
+            uint16_t current_ofst = offset + (row * num_cols + col) * sizeof(uint16_t);
+            pixels[col] = IORD_16DIRECT(dev->base, current_ofst);
+        }
+        if (keyframe) {
+            for (col = 0; col < num_cols; ++col) {
+                line[2 * col] = pixels[col] >> 8;
+                line[2 * col + 1] = pixels[col] & 0xff;
+            }
+            length = num_cols * sizeof(uint16_t);
+            delta_rle_keyframe(enc, pixels, num_cols);
+        } else {
+            length = delta_rle_encode(enc, pixels, num_cols, line);
         }
+        do {
+        	check = BT_tx_enqueue(hc05, (char *) line, length);
+        } while(check == -1);
     }
 }
 
+//FORMAT DEFINES, how the frames are sent. lepton_receiver reads P5 and D5
+#define LEPTON_ASCII 0      /* P2, lepton_send_capture, for a terminal */
+#define LEPTON_BINARY 1     /* P5, lepton_send_capture_binary */
+#define LEPTON_DMA 2        /* P5, lepton_send_capture_dma */
+#define LEPTON_DELTA 3      /* P5 key frames and D5, lepton_send_capture_delta */
+#ifndef LEPTON_FORMAT
+#define LEPTON_FORMAT LEPTON_DELTA
+#endif
+
+#define KEYFRAME_INTERVAL 16
+
+static char tx_queue[32768];
+static uint16_t prev_frame[80 * 60];
 
 int main() {
 	hc05_dev hc05 = hc05_inst(HC05_0_BASE);
+	BT_tx_ring_init(&hc05, tx_queue, sizeof(tx_queue));
+	BT_set_tx_watermark(&hc05, 256);
+	alt_ic_isr_register(HC05_0_IRQ_INTERRUPT_CONTROLLER_ID, HC05_0_IRQ,
+		BT_isr, &hc05, NULL);
 	i2c_pio_dev pio = i2c_pio_inst(I2C_PIO_0_BASE);
 	lepton_dev lepton = lepton_inst(LEPTON_0_BASE);
 	lepton_init(&lepton);
@@ -67,45 +211,55 @@ int main() {
 	i2c_pio_writebit(&pio, BIT_BLT_PWR, 1);
 	i2c_pio_writebit(&pio, BIT_BLT_ATSel, 1);
 
-	usleep(1000000); //1s to let the device boot
-
+	//the KEY pin is high once the I2C write returns, before the module boots
 	i2c_pio_writebit(&pio, BIT_BLT_EN, 1);
-	usleep(1000000); //1s to let the device boot
 
+#ifdef BT_STATS
+	//cycle counter of the stall and spin counters of BT_dump_stats
+	alt_timestamp_start();
+#endif
+	BT_reset_FIFO(&hc05, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
 	BT_set_CTRL(&hc05, BLT_UART_ON | BLT_STOP_0);
 	BT_set_baud_rate(&hc05, b38400);
+	int boot_us = BT_wait_ready(&hc05, 2000000);
+	if(boot_us == -1) {
+		printf("HC05 not answering\n End program");
+		return -1;
+	}
 
 	char response[100];
 
-	BT_send_command(&hc05, "AT+UART=115200,0,0", 18);
-		BT_get_data_terminator(&hc05, response);
-		if(strncmp(response, "OK", 2)) {
-			printf("UART command not ok\n End program");
-			return -1;
-		}
-
-	BT_send_command(&hc05, "AT+CMODE=0", 10);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n End program");
+	bt_at_engine at;
+	bt_at_cmd setup[] = {
+		{"AT+UART=115200,0,0"}, {"AT+CMODE=0"}, {"AT+ROLE=0"}
+	};
+	//sent ahead of the answers, the module answers them in order
+	BT_at_init(&at, &hc05, 4);
+	if(BT_at_run(&at, setup, sizeof(setup) / sizeof(setup[0])) != BT_AT_DONE) {
+		printf("%s command not ok\n End program", setup[at.done].cmd);
 		return -1;
 	}
-	BT_send_command(&hc05, "AT+ROLE=0", 9);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
+	uint32_t setup_us = BT_at_elapsed_us(&at);
+
+	i2c_pio_writebit(&pio, BIT_BLT_ATSel, 0);
+	//the PC receiver only listens, no traffic tells the link is up
+	if(BT_reconnect(&hc05, b115200, 0) == -1) {
+		printf("AT+RESET command not ok\n End program");
 		return -1;
 	}
+	printf("module ready in %d us, AT setup done in %" PRIu32 " us\n", boot_us,
+		setup_us);
 
-	i2c_pio_writebit(&pio, BIT_BLT_ATSel, 0);
-	BT_send_command(&hc05, "AT+RESET", 8);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n End program");
+#if LEPTON_FORMAT == LEPTON_DMA
+	if(!(BT_get_caps(&hc05) & BLT_CAPS_DMA)) {
+		printf("HC05 extension built without DMA\n End program");
 		return -1;
 	}
-	BT_set_baud_rate(&hc05, b115200);
-	BT_reset_FIFO(&hc05, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
+#endif
+	BT_clear_stats(&hc05);
+	delta_rle_enc enc;
+	delta_rle_enc_init(&enc, prev_frame, 80 * 60);
+	uint32_t frame = 0;
 
 	do {
 		printf("Connection detected.\nReady to take picture ?(y/n)");
@@ -115,8 +269,21 @@ int main() {
 				lepton_start_capture(&lepton);
 				lepton_wait_until_eof(&lepton);
 			}while(lepton_error_check(&lepton));
+#if LEPTON_FORMAT == LEPTON_ASCII
 			lepton_send_capture(&lepton, &hc05, true);
+#elif LEPTON_FORMAT == LEPTON_BINARY
+			lepton_send_capture_binary(&lepton, &hc05, true);
+#elif LEPTON_FORMAT == LEPTON_DMA
+			lepton_send_capture_dma(&lepton, &hc05, true);
+#else
+			lepton_send_capture_delta(&lepton, &hc05, true, &enc,
+				frame % KEYFRAME_INTERVAL == 0);
+#endif
+			++frame;
 			printf("\nDone.\n");
+#ifdef BT_STATS
+			BT_dump_stats(&hc05);
+#endif
 		}
 	} while(response[0]=='y');
 
@@ -8,6 +8,8 @@
 
 #include "system.h"
 #include "ressources/hc05.h"
+#include "ressources/hc05_at.h"
+#include "ressources/hc05_frame.h"
 #include "ressources/i2c_pio.h"
 #include "ressources/lepton.h"
 #include "ressources/ws2812.h"
@@ -32,88 +34,74 @@ int main() {
 	i2c_pio_writebit(&pio, BIT_BLT_PWR, 1);
 	i2c_pio_writebit(&pio, BIT_BLT_ATSel, 1);
 
-	usleep(1000000); //1s to let ATSel propagate, really needed?
-
+	//the KEY pin is high once the I2C write returns, before the module boots
 	i2c_pio_writebit(&pio, BIT_BLT_EN, 1);
 
-	usleep(1000000); //1s to let the device boot, needed
 	BT_reset_FIFO(&hc05, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
 	BT_set_CTRL(&hc05, BLT_UART_ON | BLT_STOP_0 | BLT_NO_PARITY);
 	BT_set_baud_rate(&hc05, b38400);
-	char response[100];
-    //set UART parameters : 115200bps, 0 parity, 1 stop bit
-	BT_send_command(&hc05, "AT+UART=115200,0,0", 18);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
+	int boot_us = BT_wait_ready(&hc05, 2000000);
+	if(boot_us == -1) {
+		printf("HC05 not answering\n");
 		return -1;
 	}
-
-	BT_send_command(&hc05, "AT+CMODE=0", 10);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
+	bt_at_engine at;
+	bt_at_cmd setup[] = {
+		//set UART parameters : 115200bps, 0 parity, 1 stop bit
+		{"AT+UART=115200,0,0"}, {"AT+CMODE=0"}, {"AT+ROLE=0"},
+		//to know BT ADDR, currently +ADDR:98d3:32:707966
+		{"AT+ADDR?"}
+	};
+	//sent ahead of the answers, the module answers them in order
+	BT_at_init(&at, &hc05, 4);
+	if(BT_at_run(&at, setup, sizeof(setup) / sizeof(setup[0])) != BT_AT_DONE) {
+		printf("%s command not ok\n", setup[at.done].cmd);
 		return -1;
 	}
-	BT_send_command(&hc05, "AT+ROLE=0", 9);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
-		return -1;
-	}
-
-	//to know BT ADDR
-	//currently +ADDR:98d3:32:707966
-/*
-	BT_send_command(&hc05, "AT+ADDR?", 8);
-	BT_get_data_terminator(&hc05, response);
-	printf("%s", response);
-	BT_get_all_data(&hc05, response);
-	*/
+	uint32_t setup_us = BT_at_elapsed_us(&at);
 	i2c_pio_writebit(&pio, BIT_BLT_ATSel, 0);
-	BT_send_command(&hc05, "AT+RESET", 8);
-	BT_get_data_terminator(&hc05, response);
-	if(strncmp(response, "OK", 2)) {
-		printf("UART command not ok\n");
-		return -1;
+	printf("address %s, module ready in %d us, AT setup done in %" PRIu32 " us\n",
+		setup[3].result.value, boot_us, setup_us);
+	//the host sends as soon as it is connected
+	int link_us = BT_reconnect(&hc05, b115200, 30000000);
+	if(link_us == -1) {
+		printf("no link after 30s, waiting for frames anyway\n");
+	} else {
+		printf("link up %d us after AT+RESET\n", link_us);
 	}
-	//i2c_pio_writebit(&pio, BIT_BLT_EN, 0);
-	//i2c_pio_writebit(&pio, BIT_BLT_EN, 1);
-
-	BT_reset_FIFO(&hc05, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
-	BT_set_baud_rate(&hc05, b115200);
-	char message[100];
+	char message[BT_FRAME_MAX_PAYLOAD];
+	bt_link link;
+	BT_link_init(&link, &hc05);
 	int loop = 1;
 	int stop = 1;
 
 	while(loop) {
-		BT_get_data_terminator(&hc05, message);
+		int length = BT_frame_recv(&link, message, sizeof(message));
+		if(length <= 0) {
+			continue; //nothing yet, a corrupted or too long frame
+		}
 		if(stop) {
-			if(!strncmp(message, "OFF\r\n", 5)) {
+			if(message[0] == 'O') {
 				loop = 0;
-			} else if(!strncmp(message, "START\r\n", 7)) {
+			} else if(message[0] == 'S') {
 				ws2812_writePixel(&ws2812, 0, red, green, blue);
 				ws2812_setIntensity(&ws2812, intensity);
 				stop = 0;
 			}
 		} else {
-			if(!strncmp(message, "STOP\r\n", 7)) {
+			if(message[0] == 'P') {
 				ws2812_writePixel(&ws2812, 0, 0, 0, 0);
 				ws2812_setIntensity(&ws2812, 0);
 				stop = 1;
-			} else {
-				int tmp;
-				char c;
-				sscanf(message, "%c%d", &c, &tmp);
-				switch(c) {
-				case 'R': red = tmp; break;
-				case 'G': green = tmp; break;
-				case 'B': blue = tmp; break;
-				}
+			} else if(message[0] == 'C' && length == 4) {
+				red = message[1];
+				green = message[2];
+				blue = message[3];
 				ws2812_writePixel(&ws2812, 0, red, green, blue);
 			}
 		}
 	}
+	printf("%" PRIu32 " frames lost, %" PRIu32 " corrupted\n", link.lost, link.corrupted);
 	printf("DONE");
 	return 0;
 }
@@ -1,11 +1,56 @@
+#ifdef BT_STATS
+#include <stdio.h>
+#endif
 #include <string.h>
 #include <inttypes.h>
 
 #include "hc05.h"
-#include "io.h"
+#ifdef BT_STATS
+#define BT_USE_CYCLES
+#endif
+#include "hc05_time.h"
+
+/* DMA buffers : bus address of a buffer, and data cache write back */
+#ifndef BT_DMA_ADDRESS
+#define BT_DMA_ADDRESS(PTR) ((uint32_t)(PTR))
+#endif
+#ifdef __nios2__
+#include "sys/alt_cache.h"
+#define BT_DMA_FLUSH(PTR, LEN) alt_dcache_flush((void *)(PTR), (LEN))
+#else
+#define BT_DMA_FLUSH(PTR, LEN)
+#endif
+
+static void BT_tx_refill(hc05_dev *dev);
+
+/* a send did not fit, the stall lasts until one fits */
+static void tx_refused(hc05_dev *dev) {
+#ifdef BT_STATS
+	if(!dev->stats.tx_stalled) {
+		dev->stats.tx_stall_start = BT_CYCLES(dev);
+		dev->stats.tx_stalled = 1;
+	}
+	++dev->stats.tx_refused;
+#else
+	(void) dev;
+#endif
+}
+
+static void tx_accepted(hc05_dev *dev) {
+#ifdef BT_STATS
+	if(dev->stats.tx_stalled) {
+		dev->stats.tx_stall_cycles += BT_CYCLES(dev) - dev->stats.tx_stall_start;
+		dev->stats.tx_stalled = 0;
+	}
+#else
+	(void) dev;
+#endif
+}
 
 hc05_dev hc05_inst(void *base) {
-	hc05_dev dev = {base};
+	hc05_dev dev;
+	memset(&dev, 0, sizeof(dev));
+	dev.base = base;
 	return dev;
 }
 /*
@@ -65,6 +110,32 @@ void BT_set_baud_rate(hc05_dev *dev, baud_rate rate) {
 	IOWR_32DIRECT(dev->base, BLT_UART_WAIT_CYCLES, rate);
 }
 
+/*
+ * Returns the value of the UART_baud_frac register of the HC05 component.
+ * name: BT_get_baud_frac
+ * @param dev  : The HC05 device struct.
+ * @return the fraction of cycle added to each bit, in 1/256 cycles.
+ */
+uint32_t BT_get_baud_frac(hc05_dev *dev) {
+	return IORD_32DIRECT(dev->base, BLT_UART_BAUD_FRAC);
+}
+
+/*
+ * Set the UART_baud_frac register of the HC05 component : with BLT_FRAC_BAUD
+ * in CTRL, a bit lasts UART_wait_cycles+1+frac/256 clock cycles on average.
+ * name: BT_set_baud_frac
+ * @param dev  : The HC05 device struct,
+ *        frac : the fraction, 0 to 255.
+ * @return void
+ *
+ * example: BT_set_baud_rate(&dev, 15);
+ * BT_set_baud_frac(&dev, 171); //16.67 cycles per bit, 3000000 b/s at 50MHz
+ * BT_set_CTRL(&dev, BT_get_CTRL(&dev) | BLT_FRAC_BAUD);
+ */
+void BT_set_baud_frac(hc05_dev *dev, uint32_t frac) {
+	IOWR_32DIRECT(dev->base, BLT_UART_BAUD_FRAC, frac);
+}
+
 /*
  * Returns the value of the STATUS register of the HC05 component
  * i.e. the i_pending bits.
@@ -92,6 +163,21 @@ void BT_clear_i_pending(hc05_dev *dev) {
 	IOWR_32DIRECT(dev->base, BLT_STATUS_REG, 0);
 }
 
+/*
+ * Clear some of the i_pending bits in the STATUS register of the HC05 component,
+ * leaving the other ones untouched.
+ * name: BT_ack_i_pending
+ * @param dev  : The HC05 device struct,
+ *        mask : the i_pending bits to clear.
+ * @return void
+ *
+ * example: BT_ack_i_pending(&dev, BLT_I_PENDING_RCV);
+ * clears i_received only, an i_dropped pending stays pending.
+ */
+void BT_ack_i_pending(hc05_dev *dev, uint32_t mask) {
+	IOWR_32DIRECT(dev->base, BLT_STATUS_REG, ~mask);
+}
+
 /*
  * Return the Amount of free space in the output FIFO
  * i.e. the number of bytes that can be send.
@@ -100,12 +186,51 @@ void BT_clear_i_pending(hc05_dev *dev) {
  * @return the amount of free space in the FIFO_out.
  * 
  * example: uint32_t free_space = BT_get_free_space(&dev);
- * free_space = 1023 => 1023 words can be send to the FIFO_out.
+ * free_space = 1024 => 1024 words can be send to the FIFO_out.
+ * An empty FIFO_out gives its depth, see BT_get_fifo_out_depth.
  */
 uint32_t BT_get_free_space(hc05_dev *dev) {
 	return IORD_32DIRECT(dev->base, BLT_FIFO_OUT_FREE_SPACE);
 }
 
+/*
+ * Returns the capabilities register : FIFO depths and optional units of the
+ * HC05 extension, as set by its generics.
+ * name: BT_get_caps
+ * @param dev  : The HC05 device struct.
+ * @return the capabilities, see the BLT_CAPS_* defines.
+ *
+ * example: if(BT_get_caps(&dev) & BLT_CAPS_CRC) BT_link_hw_crc(&link, 1);
+ */
+uint32_t BT_get_caps(hc05_dev *dev) {
+	return IORD_32DIRECT(dev->base, BLT_CAPS);
+}
+
+/*
+ * Returns the depth of the output FIFO.
+ * name: BT_get_fifo_out_depth
+ * @param dev  : The HC05 device struct.
+ * @return the number of words the FIFO_out holds.
+ *
+ * example: uint32_t depth = BT_get_fifo_out_depth(&dev); //1024 to 16384
+ */
+uint32_t BT_get_fifo_out_depth(hc05_dev *dev) {
+	return 1u << (BT_get_caps(dev) & BLT_CAPS_FIFO_OUT_LOG2_MASK);
+}
+
+/*
+ * Returns the depth of the input FIFO.
+ * name: BT_get_fifo_in_depth
+ * @param dev  : The HC05 device struct.
+ * @return the number of words the FIFO_in holds.
+ *
+ * example: uint32_t depth = BT_get_fifo_in_depth(&dev); //1024 to 16384
+ */
+uint32_t BT_get_fifo_in_depth(hc05_dev *dev) {
+	return 1u << ((BT_get_caps(dev) & BLT_CAPS_FIFO_IN_LOG2_MASK)
+		>> BLT_CAPS_FIFO_IN_LOG2_SHIFT);
+}
+
 /*
  * Send a single byte to output FIFO without any verification.
  * name: BT_send_word
@@ -124,6 +249,34 @@ void BT_send_word(hc05_dev *dev, char word) {
 	IOWR_8DIRECT(dev->base, BLT_FIFO_OUT_DATA, word);
 }
 
+/*
+ * Copy bytes to the output FIFO without any verification. The 4-byte aligned
+ * middle of the buffer goes through FIFO_out_data32, 4 bytes per bus access.
+ * name: BT_write_FIFO_out
+ * @param dev    : The HC05 device struct,
+ *        data   : the bytes to send,
+ *        length : the amount of bytes to send.
+ * @return void
+ *
+ * /!\
+ * The data will be dropped if the FIFO is full.
+ * ONLY USE WHEN YOU KNOW HOW MUCH SPACE IS AVAILABLE.
+ */
+void BT_write_FIFO_out(hc05_dev *dev, const char *data, uint32_t length) {
+	uint32_t i = 0;
+	while(i < length && ((uintptr_t)(data + i) & 3) != 0) {
+		BT_send_word(dev, data[i++]);
+	}
+	for(; i + 4 <= length; i += 4) {
+		uint32_t word;
+		memcpy(&word, data + i, 4); //aligned, a single load
+		IOWR_32DIRECT(dev->base, BLT_FIFO_OUT_DATA32, word);
+	}
+	while(i < length) {
+		BT_send_word(dev, data[i++]);
+	}
+}
+
 /*
  * Send a single byte to the output FIFO, checking before if it is possible
  * and returning the free space after the send.
@@ -139,8 +292,10 @@ void BT_send_word(hc05_dev *dev, char word) {
 int BT_send_word_safe(hc05_dev *dev, char word) {
 	uint32_t space = BT_get_free_space(dev);
 	if(space == 0) {
+		tx_refused(dev);
 		return -1;
 	} else {
+		tx_accepted(dev);
 		BT_send_word(dev, word);
 		return space -1;
 	}
@@ -163,15 +318,47 @@ int BT_send_word_safe(hc05_dev *dev, char word) {
 int BT_send_message(hc05_dev *dev, char* message, uint32_t length) {
 	uint32_t space = BT_get_free_space(dev);
 	if(length > space) {
+		tx_refused(dev);
 		return -1;
 	} else {
-		for(uint32_t i = 0; i < length; ++i) {
-			BT_send_word(dev, message[i]);
-		}
+		tx_accepted(dev);
+		BT_write_FIFO_out(dev, message, length);
 		return space - (length);
 	}
 }
 
+/*
+ * Send a message made of several buffers, with a single check of the free
+ * space for the whole message. Each piece is copied straight to the output
+ * FIFO, no intermediate buffer is needed to assemble the message.
+ * name: BT_sendv
+ * @param dev   : The HC05 device struct,
+ *        iov   : the pieces of the message, in order,
+ *        count : the number of pieces.
+ * @return the amount free space after the send
+ *          or -1 if the send couldn't be done (nothing is sent).
+ *
+ * example: bt_iov msg[2] = {{header, 12}, {row, 160}};
+ * int free_space = BT_sendv(&dev, msg, 2);
+ */
+int BT_sendv(hc05_dev *dev, const bt_iov *iov, uint32_t count) {
+	uint32_t length = 0;
+	for(uint32_t i = 0; i < count; ++i) {
+		length += iov[i].length;
+	}
+	uint32_t space = BT_get_free_space(dev);
+	if(length > space) {
+		tx_refused(dev);
+		return -1;
+	} else {
+		tx_accepted(dev);
+		for(uint32_t i = 0; i < count; ++i) {
+			BT_write_FIFO_out(dev, iov[i].base, iov[i].length);
+		}
+		return space - length;
+	}
+}
+
 /*
  * Use this function when in the AT mode.
  * Same as send_message but add the "\r\n" string at the end of the message.
@@ -188,11 +375,11 @@ int BT_send_message(hc05_dev *dev, char* message, uint32_t length) {
 int BT_send_command(hc05_dev *dev, char* message, uint32_t length) {
 	uint32_t space = BT_get_free_space(dev);
 	if(length+2 > space) {
+		tx_refused(dev);
 		return -1;
 	} else {
-		for(uint32_t i = 0; i < length; ++i) {
-			BT_send_word(dev, message[i]);
-		}
+		tx_accepted(dev);
+		BT_write_FIFO_out(dev, message, length);
 		BT_send_word(dev, '\r');
 		BT_send_word(dev, '\n');
 		return space - (length+2);
@@ -210,11 +397,12 @@ int BT_send_command(hc05_dev *dev, char* message, uint32_t length) {
  * pending = 4 => 4 words waiting in the FIFO.
  */
 uint32_t BT_get_pending_data(hc05_dev *dev) {
-	return IORD_32DIRECT(dev->base, BLT_FIFO_IN_PENDING_DATA);
+	return IORD_32DIRECT(dev->base, BLT_FIFO_IN_PENDING_DATA) & BLT_FIFO_IN_PENDING_MASK;
 }
 
 /*
  * Wait until at least amount words are waiting in the FIFO_IN.
+ * With BT_STATS, the time spent spinning is added to dev->stats.
  * name: BT_wait_for_data
  * @param dev  : The HC05 device struct.
  * 		  amount : The minimum amount of words expected.
@@ -225,8 +413,25 @@ uint32_t BT_get_pending_data(hc05_dev *dev) {
  * pending = 4 => 4 words waiting in the FIFO.
  */
 uint32_t BT_wait_for_data(hc05_dev *dev, uint32_t amount) {
-	volatile uint32_t pending = 0;
-	while((pending = BT_get_pending_data(dev)) < amount);
+	uint32_t pending = BT_get_pending_data(dev);
+	if(pending >= amount) {
+		return pending;
+	}
+#ifdef BT_STATS
+	uint64_t start = BT_CYCLES(dev);
+	uint64_t polls = 0;
+	do {
+		pending = BT_get_pending_data(dev);
+		++polls;
+	} while(pending < amount);
+	++dev->stats.wait_calls;
+	dev->stats.wait_polls += polls;
+	dev->stats.wait_cycles += BT_CYCLES(dev) - start;
+#else
+	do {
+		pending = BT_get_pending_data(dev);
+	} while(pending < amount);
+#endif
 	return pending;
 }
 /*
@@ -246,6 +451,30 @@ char BT_get_data(hc05_dev *dev) {
     return IORD_32DIRECT(dev->base, BLT_FIFO_IN_DATA);
 }
 
+/*
+ * Copy bytes from the input FIFO without any verification. Groups of 4 bytes
+ * are read through FIFO_in_data32, the last 0 to 3 bytes one by one.
+ * name: BT_read_FIFO_in
+ * @param dev    : The HC05 device struct,
+ *        data   : a pointer to a char array that will contain the data,
+ *        amount : the amount of bytes to read.
+ * @return void
+ *
+ * /!\
+ * There is no guarantee on the data if the FIFO had less than amount elements.
+ * ONLY USE WHEN YOU KNOW HOW MUCH DATA IS WAITING.
+ */
+void BT_read_FIFO_in(hc05_dev *dev, char *data, uint32_t amount) {
+	uint32_t i = 0;
+	for(; i + 4 <= amount; i += 4) {
+		uint32_t word = IORD_32DIRECT(dev->base, BLT_FIFO_IN_DATA32);
+		memcpy(data + i, &word, 4);
+	}
+	for(; i < amount; ++i) {
+		data[i] = BT_get_data(dev);
+	}
+}
+
 /*
  * Get a single byte from the input FIFO, performing a check before
  * and returning the amount of pending data after the read.
@@ -286,12 +515,33 @@ int BT_get_data_safe(hc05_dev *dev, char* data) {
  * ONLY USE WHEN YOU KNOW HOW MUCH DATA IS WAITING.
  */
 void BT_get_amount_data(hc05_dev *dev, char *data, uint32_t amount) {
-	volatile char c;
-    for(uint32_t i = 0; i < amount; ++i) {
-    	c = BT_get_data(dev);
-        data[i] = c;
-    }
-    data[amount] = '\0';
+	BT_read_FIFO_in(dev, data, amount);
+	data[amount] = '\0';
+}
+
+/*
+ * Read up to max bytes waiting in the input FIFO, 4 bytes per bus access
+ * through FIFO_in_data32.
+ * name: BT_read
+ * @param dev  : The HC05 device struct,
+ *        data : a pointer to a char array that will contain the data,
+ *        max  : the size of data.
+ * @return the amount of char read or -1 if there was no data pending.
+ *
+ * example: char data[1024]; int read = BT_read(&dev, data, 1024);
+ * read = amount of char read, data[0..read-1] = data received.
+ * A full FIFO_in is read with 257 bus reads instead of 1025.
+ */
+int BT_read(hc05_dev *dev, char *data, uint32_t max) {
+	uint32_t pend = BT_get_pending_data(dev);
+	if(pend == 0) {
+		return -1;
+	}
+	if(pend > max) {
+		pend = max;
+	}
+	BT_read_FIFO_in(dev, data, pend);
+	return pend;
 }
 
 /*
@@ -324,6 +574,10 @@ int BT_get_all_data(hc05_dev *dev, char *data) {
  *
  * example: char data[100]; int read = BT_get_data_terminator(&dev, data);
  * read = amout of char read, data[0..read-1] = data received
+ *
+ * /!\
+ * Blocks until "\r\n" comes and writes to data without bound, BT_read_line
+ * does neither.
  */
 int BT_get_data_terminator(hc05_dev *dev, char *data) {
 	int r = 0;
@@ -342,6 +596,131 @@ int BT_get_data_terminator(hc05_dev *dev, char *data) {
 	return r;
 }
 
+/*
+ * Index of the '\n' ending the first "\r\n" of buffer[from-1..end), -1 if
+ * there is none. The '\n' are looked for 4 bytes at a time : a byte of
+ * word ^ 0x0A0A0A0A is zero where there is one, and (x - 0x01..) & ~x & 0x80..
+ * flags it. The lowest flag is the first '\n' (little endian, as the Nios II),
+ * the flags above it may be wrong, each one is checked.
+ */
+static int32_t find_crlf(const char *buffer, uint32_t from, uint32_t end) {
+	uint32_t i = from;
+	for(; i + 4 <= end; i += 4) {
+		uint32_t word;
+		memcpy(&word, buffer + i, 4);
+		word ^= 0x0A0A0A0A;
+		uint32_t flags = (word - 0x01010101) & ~word & 0x80808080;
+		while(flags != 0) {
+			uint32_t at = i + (__builtin_ctz(flags) >> 3);
+			if(buffer[at] == '\n' && buffer[at - 1] == '\r') {
+				return at;
+			}
+			flags &= flags - 1;
+		}
+	}
+	for(; i < end; ++i) {
+		if(buffer[i] == '\n' && buffer[i - 1] == '\r') {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Initialize a line reader : BT_read_line moves everything waiting into
+ * buffer at once, and keeps the bytes after the line it returns for the next
+ * call.
+ * name: BT_line_init
+ * @param reader : The line reader,
+ *        dev    : The HC05 device struct,
+ *        buffer : the storage of the reader,
+ *        size   : the size of buffer, the longest line with its "\r\n".
+ * @return void
+ *
+ * example: static char line_buf[256];
+ * bt_line_reader reader;
+ * BT_line_init(&reader, &dev, line_buf, sizeof(line_buf));
+ */
+void BT_line_init(bt_line_reader *reader, hc05_dev *dev, char *buffer,
+		uint32_t size) {
+	reader->dev = dev;
+	reader->buffer = buffer;
+	reader->size = size;
+	reader->start = 0;
+	reader->end = 0;
+	reader->scanned = 0;
+}
+
+/*
+ * Non blocking read of a "\r\n" terminated line. The bytes waiting in the
+ * FIFO_in (or in the receive ring buffer if BT_isr fills it) are read in one
+ * go, FIFO_in_data32 giving 4 per bus access, only when the bytes already
+ * kept hold no whole line.
+ * name: BT_read_line
+ * @param reader : The line reader,
+ *        line   : receives the line, without "\r\n" and '\0' terminated,
+ *        max    : the size of line, lines up to max-1 chars are returned.
+ * @return the amount of char put in line, BT_LINE_NONE if no whole line is
+ *          there yet, BT_LINE_TOO_LONG if a line does not fit in line (it
+ *          is dropped, nothing is kept if max is 0) or if the buffer of the
+ *          reader got full without "\r\n" (its bytes are dropped, the end
+ *          of the line comes as a line of its own).
+ *
+ * example: char line[64];
+ * int length = BT_read_line(&reader, line, sizeof(line));
+ * //"+ADDR:98d3:32:707966\r\nOK\r\n" received : length = 20, then 2 on
+ * //the next call without any bus access, then BT_LINE_NONE
+ */
+int BT_read_line(bt_line_reader *reader, char *line, uint32_t max) {
+	int received = 0;
+	if(max == 0) {
+		return BT_LINE_TOO_LONG;
+	}
+	for(;;) {
+		uint32_t from = reader->scanned > reader->start ? reader->scanned
+			: reader->start + 1;
+		int32_t at = find_crlf(reader->buffer, from, reader->end);
+		if(at != -1) {
+			uint32_t length = at - 1 - reader->start;
+			uint32_t first = reader->start;
+			reader->start = at + 1;
+			reader->scanned = reader->start;
+			if(length > max - 1) {
+				return BT_LINE_TOO_LONG;
+			}
+			memcpy(line, reader->buffer + first, length);
+			line[length] = '\0';
+			return length;
+		}
+		reader->scanned = reader->end;
+		if(reader->start == 0 && reader->end == reader->size) {
+			reader->end = 0;
+			reader->scanned = 0;
+			return BT_LINE_TOO_LONG;
+		}
+		if(received) {
+			return BT_LINE_NONE;
+		}
+		//keep the start of the line at the start of the buffer
+		if(reader->start != 0) {
+			memmove(reader->buffer, reader->buffer + reader->start,
+				reader->end - reader->start);
+			reader->end -= reader->start;
+			reader->scanned -= reader->start;
+			reader->start = 0;
+		}
+		uint32_t room = reader->size - reader->end;
+		int n = reader->dev->rx.buffer != NULL
+			? (int) BT_rx_read(reader->dev, reader->buffer + reader->end, room)
+			: BT_read(reader->dev, reader->buffer + reader->end, room);
+		if(n <= 0) {
+			return BT_LINE_NONE;
+		}
+		reader->end += n;
+		received = 1;
+	}
+}
+
 /*
  * Clear the specified FIFO.
  * name: BT_reset_FIFO
@@ -355,3 +734,674 @@ int BT_get_data_terminator(hc05_dev *dev, char *data) {
 void BT_reset_FIFO(hc05_dev *dev, uint32_t val) {
 	IOWR_32DIRECT(dev->base, BLT_RESET_FIFO, val);
 }
+
+/*
+ * Give a buffer to the device to store the data received under interrupt.
+ * name: BT_rx_ring_init
+ * @param dev    : The HC05 device struct,
+ *        buffer : the storage of the ring buffer,
+ *        size   : the size of buffer, must be a power of two.
+ * @return 0 on success or -1 if size is not a power of two.
+ *
+ * example: static char rx_buf[4096];
+ * BT_rx_ring_init(&dev, rx_buf, 4096);
+ * alt_ic_isr_register(HC05_0_IRQ_INTERRUPT_CONTROLLER_ID, HC05_0_IRQ,
+ *                     BT_isr, &dev, NULL);
+ * BT_rx_irq_enable(&dev);
+ */
+int BT_rx_ring_init(hc05_dev *dev, char *buffer, uint32_t size) {
+	if(size == 0 || (size & (size - 1)) != 0) {
+		return -1;
+	}
+	dev->rx.buffer = buffer;
+	dev->rx.size = size;
+	dev->rx.head = 0;
+	dev->rx.tail = 0;
+	dev->rx.held = 0;
+	dev->rx.full = 0;
+	dev->rx.i_dropped = 0;
+	return 0;
+}
+
+/*
+ * Enable the i_received, i_dropped and i_rx_idle interrupts, keeping the other
+ * CTRL bits.
+ * name: BT_rx_irq_enable
+ * @param dev  : The HC05 device struct.
+ * @return void
+ *
+ * example: BT_rx_irq_enable(&dev);
+ */
+void BT_rx_irq_enable(hc05_dev *dev) {
+	BT_set_CTRL(dev, BT_get_CTRL(dev) | BLT_I_ENABLE_RCV | BLT_I_ENABLE_DROP
+		| BLT_I_ENABLE_RX_IDLE);
+}
+
+/*
+ * Disable the i_received, i_dropped and i_rx_idle interrupts, keeping the
+ * other CTRL bits.
+ * name: BT_rx_irq_disable
+ * @param dev  : The HC05 device struct.
+ * @return void
+ *
+ * example: BT_rx_irq_disable(&dev);
+ */
+void BT_rx_irq_disable(hc05_dev *dev) {
+	BT_set_CTRL(dev, BT_get_CTRL(dev) & ~(BLT_I_ENABLE_RCV | BLT_I_ENABLE_DROP
+		| BLT_I_ENABLE_RX_IDLE));
+}
+
+/*
+ * Set the FIFO_in level from which i_received is raised : each received byte
+ * raises it while at least level bytes are waiting. 0 or 1 gives one
+ * interrupt per byte.
+ * name: BT_set_rx_watermark
+ * @param dev   : The HC05 device struct,
+ *        level : the watermark, in words (0 to FIFO_in depth).
+ * @return void
+ *
+ * example: BT_set_rx_watermark(&dev, 64);
+ * BT_set_rx_timeout(&dev, 20);
+ * BT_isr runs once per 64 bytes, and 2 frames after the end of a message.
+ */
+void BT_set_rx_watermark(hc05_dev *dev, uint32_t level) {
+	IOWR_32DIRECT(dev->base, BLT_RX_WATERMARK, level);
+}
+
+/*
+ * Set the silence after which i_rx_idle is raised if bytes are waiting in the
+ * FIFO_in, so that messages shorter than the rx watermark are delivered.
+ * It is raised once per burst of bytes.
+ * name: BT_set_rx_timeout
+ * @param dev       : The HC05 device struct,
+ *        bit_times : the silence, in bit times of the current baud rate
+ *                    (1 to 65535), 0 disables i_rx_idle.
+ * @return void
+ *
+ * example: BT_set_rx_timeout(&dev, 20); //2 frames of 10 bits
+ */
+void BT_set_rx_timeout(hc05_dev *dev, uint32_t bit_times) {
+	IOWR_32DIRECT(dev->base, BLT_RX_TIMEOUT, bit_times);
+}
+
+/*
+ * Set the FIFO_in level from which nBLT_RTS is deasserted with flow control.
+ * The module may still send a few bytes after RTS goes high : keep at least
+ * 16 words of headroom (the reset value is the FIFO_in depth - 16).
+ * name: BT_set_rts_threshold
+ * @param dev   : The HC05 device struct,
+ *        level : the threshold, in words (1 to FIFO_in depth).
+ * @return void
+ *
+ * example: BT_set_rts_threshold(&dev, BT_get_fifo_in_depth(&dev) - 32);
+ */
+void BT_set_rts_threshold(hc05_dev *dev, uint32_t level) {
+	IOWR_32DIRECT(dev->base, BLT_RTS_THRESHOLD, level);
+}
+
+/*
+ * Turn RTS/CTS flow control on or off. When on, nBLT_RTS asks the module to
+ * stop sending while the FIFO_in is at the rts threshold, and a frame is only
+ * sent while the module holds nBLT_CTS low. When off, nBLT_RTS stays low and
+ * nBLT_CTS is ignored.
+ * The UART_RTS and UART_CTS pins of the module must be wired to nBLT_CTS and
+ * nBLT_RTS, or the pins tied low.
+ * name: BT_set_flow_control
+ * @param dev : The HC05 device struct,
+ *        on  : 1 to turn flow control on, 0 to turn it off.
+ * @return void
+ *
+ * example: BT_set_flow_control(&dev, 1);
+ */
+void BT_set_flow_control(hc05_dev *dev, int on) {
+	uint32_t ctrl = BT_get_CTRL(dev) & ~BLT_FLOW_CTRL;
+	BT_set_CTRL(dev, on ? ctrl | BLT_FLOW_CTRL : ctrl);
+}
+
+/*
+ * Move the FIFO_in to the receive ring, as much as fits. Returns the amount of
+ * bytes left in the FIFO_in.
+ */
+static uint32_t rx_fill(hc05_dev *dev) {
+	hc05_rx_ring *rx = &dev->rx;
+	uint32_t head = rx->head;
+	uint32_t mask = rx->size - 1;
+	uint32_t pend = BT_get_pending_data(dev);
+	uint32_t n = rx->size - (head - rx->tail);
+	if(n > pend) {
+		n = pend;
+	}
+	uint32_t first = rx->size - (head & mask);
+	if(first > n) {
+		first = n;
+	}
+	BT_read_FIFO_in(dev, rx->buffer + (head & mask), first);
+	BT_read_FIFO_in(dev, rx->buffer, n - first);
+	rx->head = head + n;
+	return pend - n;
+}
+
+/* ring full : no more i_received nor i_rx_idle until BT_rx_read */
+static void rx_hold(hc05_dev *dev) {
+	BT_set_CTRL(dev, BT_get_CTRL(dev) & ~(BLT_I_ENABLE_RCV
+		| BLT_I_ENABLE_RX_IDLE));
+}
+
+/*
+ * Interrupt service routine of the HC05 component.
+ * Clears i_pending, refills the FIFO_out from the transmit queue on i_tx_low,
+ * reports the end of DMA transfers in dma_done and to the DMA callback,
+ * then moves everything waiting in the FIFO_in to the receive ring buffer.
+ * When the ring is full, the bytes left stay in the FIFO_in : i_received and
+ * i_rx_idle are masked until BT_rx_read makes room, so that the FIFO_in fills
+ * up and nBLT_RTS holds the remote side with flow control on. i_dropped
+ * interrupts are counted in rx.i_dropped.
+ * name: BT_isr
+ * @param context : The HC05 device struct, as given to alt_ic_isr_register.
+ * @return void
+ *
+ * i_pending is cleared before draining, so that a byte received during the
+ * drain raises the irq again instead of waiting in the FIFO_in.
+ */
+void BT_isr(void *context) {
+	hc05_dev *dev = (hc05_dev *) context;
+	hc05_rx_ring *rx = &dev->rx;
+	uint32_t i_pending = BT_get_i_pending(dev);
+	uint32_t handled = i_pending & (BLT_I_PENDING_RCV | BLT_I_PENDING_DROP
+		| BLT_I_PENDING_DMA_TX | BLT_I_PENDING_DMA_RX | BLT_I_PENDING_RX_IDLE);
+	//i_tx_low is left pending while BT_tx_enqueue has it masked
+	if((i_pending & BLT_I_PENDING_TX_LOW)
+			&& (BT_get_CTRL(dev) & BLT_I_ENABLE_TX_LOW)) {
+		handled |= BLT_I_PENDING_TX_LOW;
+	}
+	BT_ack_i_pending(dev, handled);
+	if(handled & BLT_I_PENDING_TX_LOW) {
+		BT_tx_refill(dev);
+	}
+	if(i_pending & BLT_I_PENDING_DROP) {
+		++rx->i_dropped;
+	}
+	uint32_t done = i_pending & (BLT_I_PENDING_DMA_TX | BLT_I_PENDING_DMA_RX);
+	if(done != 0) {
+		dev->dma_done |= done;
+		if(dev->dma_callback) {
+			dev->dma_callback(dev->dma_arg, done);
+		}
+	}
+	if(rx->size == 0) {
+		return;
+	}
+	if(rx->held) {
+		//CTRL written back by a read-modify-write of the main program
+		rx_hold(dev);
+		return;
+	}
+	if(rx_fill(dev) != 0) {
+		++rx->full;
+		rx->held = 1;
+		rx_hold(dev);
+	}
+}
+
+/*
+ * Returns the amount of bytes waiting in the receive ring buffer.
+ * name: BT_rx_available
+ * @param dev  : The HC05 device struct.
+ * @return the amount of bytes that BT_rx_read can return.
+ *
+ * example: if(BT_rx_available(&dev) >= 7) //a whole "START\r\n" is there
+ */
+uint32_t BT_rx_available(hc05_dev *dev) {
+	return dev->rx.head - dev->rx.tail;
+}
+
+/*
+ * Non blocking read from the receive ring buffer. If BT_isr found the ring
+ * full, the bytes it left in the FIFO_in are moved to the room made and the
+ * receive interrupts enabled again once they all fit.
+ * name: BT_rx_read
+ * @param dev  : The HC05 device struct,
+ *        data : a pointer to a char array that will contain the data,
+ *        max  : the size of data.
+ * @return the amount of bytes read, 0 if nothing was received.
+ *
+ * example: char data[64]; uint32_t n = BT_rx_read(&dev, data, 64);
+ * data[0..n-1] = data received, returns immediately.
+ */
+uint32_t BT_rx_read(hc05_dev *dev, char *data, uint32_t max) {
+	hc05_rx_ring *rx = &dev->rx;
+	uint32_t tail = rx->tail;
+	uint32_t mask = rx->size - 1;
+	uint32_t n = rx->head - tail;
+	if(n > max) {
+		n = max;
+	}
+	for(uint32_t i = 0; i < n; ++i) {
+		data[i] = rx->buffer[(tail + i) & mask];
+	}
+	rx->tail = tail + n;
+	//BT_isr leaves the ring alone while held, the bytes it left come first
+	if(rx->held && n != 0 && rx_fill(dev) == 0) {
+		rx->held = 0;
+		BT_set_CTRL(dev, BT_get_CTRL(dev) | BLT_I_ENABLE_RCV
+			| BLT_I_ENABLE_RX_IDLE);
+	}
+	return n;
+}
+
+/*
+ * Give a buffer to the device to queue the data to send under interrupt.
+ * name: BT_tx_ring_init
+ * @param dev    : The HC05 device struct,
+ *        buffer : the storage of the transmit queue,
+ *        size   : the size of buffer, must be a power of two.
+ * @return 0 on success or -1 if size is not a power of two.
+ *
+ * example: static char tx_buf[32768];
+ * BT_tx_ring_init(&dev, tx_buf, 32768);
+ * BT_set_tx_watermark(&dev, 256);
+ * alt_ic_isr_register(HC05_0_IRQ_INTERRUPT_CONTROLLER_ID, HC05_0_IRQ,
+ *                     BT_isr, &dev, NULL);
+ */
+int BT_tx_ring_init(hc05_dev *dev, char *buffer, uint32_t size) {
+	if(size == 0 || (size & (size - 1)) != 0) {
+		return -1;
+	}
+	dev->tx.buffer = buffer;
+	dev->tx.size = size;
+	dev->tx.head = 0;
+	dev->tx.tail = 0;
+	return 0;
+}
+
+/*
+ * Set the FIFO_out level under which the i_tx_low interrupt is raised.
+ * name: BT_set_tx_watermark
+ * @param dev   : The HC05 device struct,
+ *        level : the watermark, in words (0 to FIFO_out depth - 1).
+ * @return void
+ *
+ * example: BT_set_tx_watermark(&dev, 256);
+ * the FIFO_out is refilled when less than 256 words are left to send.
+ */
+void BT_set_tx_watermark(hc05_dev *dev, uint32_t level) {
+	IOWR_32DIRECT(dev->base, BLT_TX_WATERMARK, level);
+}
+
+/*
+ * Move as much of the transmit queue as possible to the FIFO_out.
+ * Must not run concurrently with itself : called by BT_isr on i_tx_low, and by
+ * BT_tx_enqueue with i_tx_low masked.
+ */
+static void BT_tx_refill(hc05_dev *dev) {
+	hc05_tx_ring *tx = &dev->tx;
+	uint32_t tail = tx->tail;
+	uint32_t mask = tx->size - 1;
+	uint32_t n = tx->head - tail;
+	if(n == 0) {
+		return;
+	}
+	uint32_t space = BT_get_free_space(dev);
+	if(n > space) {
+		n = space;
+	}
+	uint32_t first = tx->size - (tail & mask);
+	if(first > n) {
+		first = n;
+	}
+	BT_write_FIFO_out(dev, tx->buffer + (tail & mask), first);
+	BT_write_FIFO_out(dev, tx->buffer, n - first);
+	tx->tail = tail + n;
+}
+
+/*
+ * Queue a message to send and return immediately. The FIFO_out is filled
+ * right away and then refilled by BT_isr each time its level goes below
+ * the watermark.
+ * name: BT_tx_enqueue
+ * @param dev     : The HC05 device struct,
+ *        data    : the message to send,
+ *        length  : the length of the message to send.
+ * @return the free space left in the transmit queue
+ *          or -1 if the message didn't fit (nothing is queued).
+ *
+ * example: int free_space = BT_tx_enqueue(&dev, frame, 9600);
+ * the whole frame is queued, the CPU is free to do something else.
+ */
+int BT_tx_enqueue(hc05_dev *dev, const char *data, uint32_t length) {
+	bt_iov iov = {data, length};
+	return BT_tx_enqueuev(dev, &iov, 1);
+}
+
+/*
+ * Same as BT_tx_enqueue for a message made of several buffers. Either the
+ * whole message is queued or nothing is.
+ * name: BT_tx_enqueuev
+ * @param dev   : The HC05 device struct,
+ *        iov   : the pieces of the message, in order,
+ *        count : the number of pieces.
+ * @return the free space left in the transmit queue
+ *          or -1 if the message didn't fit (nothing is queued).
+ *
+ * example: bt_iov msg[2] = {{header, 12}, {pixels, 9600}};
+ * int free_space = BT_tx_enqueuev(&dev, msg, 2);
+ */
+int BT_tx_enqueuev(hc05_dev *dev, const bt_iov *iov, uint32_t count) {
+	hc05_tx_ring *tx = &dev->tx;
+	uint32_t head = tx->head;
+	uint32_t mask = tx->size - 1;
+	uint32_t space = tx->size - (head - tx->tail);
+	uint32_t length = 0;
+	for(uint32_t i = 0; i < count; ++i) {
+		length += iov[i].length;
+	}
+	if(length > space) {
+		return -1;
+	}
+	for(uint32_t i = 0; i < count; ++i) {
+		uint32_t first = tx->size - (head & mask);
+		if(first > iov[i].length) {
+			first = iov[i].length;
+		}
+		memcpy(tx->buffer + (head & mask), iov[i].base, first);
+		memcpy(tx->buffer, iov[i].base + first, iov[i].length - first);
+		head += iov[i].length;
+	}
+	tx->head = head;
+	//BT_isr only masks the receive interrupts of a held ring, were it to run
+	//in between, the next BT_isr masks them again
+	uint32_t ctrl = BT_get_CTRL(dev);
+	BT_set_CTRL(dev, ctrl & ~BLT_I_ENABLE_TX_LOW);
+	BT_tx_refill(dev);
+	BT_set_CTRL(dev, ctrl | BLT_I_ENABLE_TX_LOW);
+	return space - length;
+}
+
+/*
+ * Returns the amount of bytes of the transmit queue not yet in the FIFO_out.
+ * name: BT_tx_pending
+ * @param dev  : The HC05 device struct.
+ * @return the amount of bytes still queued.
+ *
+ * example: while(BT_tx_pending(&dev) != 0); //wait for the end of the frame
+ */
+uint32_t BT_tx_pending(hc05_dev *dev) {
+	return dev->tx.head - dev->tx.tail;
+}
+
+/*
+ * Seed the CRC-16 accumulator of the bytes written to the FIFO_out.
+ * name: BT_set_crc_out
+ * @param dev  : The HC05 device struct,
+ *        seed : the starting value, 0xFFFF for CRC-16/CCITT.
+ * @return void
+ *
+ * example: BT_set_crc_out(&dev, 0xFFFF);
+ * BT_write_FIFO_out(&dev, msg, len);
+ * uint16_t crc = BT_get_crc_out(&dev); //crc = BT_crc16(0xFFFF, msg, len)
+ */
+void BT_set_crc_out(hc05_dev *dev, uint16_t seed) {
+	IOWR_32DIRECT(dev->base, BLT_CRC_OUT, seed);
+}
+
+/*
+ * Returns the CRC-16 of the bytes written to the FIFO_out since the last seed.
+ * name: BT_get_crc_out
+ * @param dev  : The HC05 device struct.
+ * @return the CRC.
+ *
+ * example: uint16_t crc = BT_get_crc_out(&dev);
+ */
+uint16_t BT_get_crc_out(hc05_dev *dev) {
+	return IORD_32DIRECT(dev->base, BLT_CRC_OUT) & 0xffff;
+}
+
+/*
+ * Seed the CRC-16 accumulator of the bytes read from the FIFO_in.
+ * name: BT_set_crc_in
+ * @param dev  : The HC05 device struct,
+ *        seed : the starting value, 0xFFFF for CRC-16/CCITT.
+ * @return void
+ *
+ * example: BT_set_crc_in(&dev, 0xFFFF);
+ */
+void BT_set_crc_in(hc05_dev *dev, uint16_t seed) {
+	IOWR_32DIRECT(dev->base, BLT_CRC_IN, seed);
+}
+
+/*
+ * Returns the CRC-16 of the bytes read from the FIFO_in since the last seed.
+ * name: BT_get_crc_in
+ * @param dev  : The HC05 device struct.
+ * @return the CRC.
+ *
+ * example: BT_set_crc_in(&dev, 0xFFFF);
+ * BT_read_FIFO_in(&dev, msg, len);
+ * uint16_t crc = BT_get_crc_in(&dev); //crc = BT_crc16(0xFFFF, msg, len)
+ */
+uint16_t BT_get_crc_in(hc05_dev *dev) {
+	return IORD_32DIRECT(dev->base, BLT_CRC_IN) & 0xffff;
+}
+
+/*
+ * Start sending a buffer with the TX DMA channel. The extension reads the
+ * buffer and fills the FIFO_out by itself, the end of the transfer sets
+ * BLT_I_PENDING_DMA_TX. Don't write to the FIFO_out (BT_send_*, transmit
+ * queue) until it is done, the bytes would be interleaved.
+ * name: BT_send_dma
+ * @param dev    : The HC05 device struct,
+ *        buffer : the bytes to send, must not change until the end,
+ *        length : the amount of bytes.
+ * @return 0 if the transfer started, -1 if the TX channel is busy.
+ *
+ * example: BT_send_dma(&dev, frame, 9600);
+ * do something else...
+ * while(BT_dma_tx_left(&dev) != 0);
+ */
+int BT_send_dma(hc05_dev *dev, const void *buffer, uint32_t length) {
+	if(BT_dma_tx_left(dev) != 0) {
+		return -1;
+	}
+	BT_DMA_FLUSH(buffer, length);
+	dev->dma_done &= ~BLT_I_PENDING_DMA_TX;
+	IOWR_32DIRECT(dev->base, BLT_DMA_TX_ADDR, BT_DMA_ADDRESS(buffer));
+	IOWR_32DIRECT(dev->base, BLT_DMA_TX_LEN, length);
+	return 0;
+}
+
+/*
+ * Start receiving into a buffer with the RX DMA channel. The extension moves
+ * the bytes of the FIFO_in to the buffer as they arrive, the end of the
+ * transfer sets BLT_I_PENDING_DMA_RX. Don't read the FIFO_in until it is done.
+ * name: BT_recv_dma
+ * @param dev    : The HC05 device struct,
+ *        buffer : where to put the bytes, not to be read until the end,
+ *        length : the amount of bytes to receive.
+ * @return 0 if the transfer started,
+ *          -1 if the RX channel is busy or BT_isr drains the FIFO_in into a
+ *          receive ring (BT_rx_ring_init).
+ *
+ * example: char msg[64];
+ * BT_recv_dma(&dev, msg, 64);
+ * while(BT_dma_rx_left(&dev) != 0);
+ */
+int BT_recv_dma(hc05_dev *dev, void *buffer, uint32_t length) {
+	if(dev->rx.size != 0 || BT_dma_rx_left(dev) != 0) {
+		return -1;
+	}
+	BT_DMA_FLUSH(buffer, length); //no dirty line written back over the bytes
+	dev->dma_done &= ~BLT_I_PENDING_DMA_RX;
+	IOWR_32DIRECT(dev->base, BLT_DMA_RX_ADDR, BT_DMA_ADDRESS(buffer));
+	IOWR_32DIRECT(dev->base, BLT_DMA_RX_LEN, length);
+	return 0;
+}
+
+/*
+ * Returns the amount of bytes the TX DMA channel still has to send.
+ * name: BT_dma_tx_left
+ * @param dev  : The HC05 device struct.
+ * @return the amount of bytes left, 0 when the channel is idle.
+ *
+ * example: while(BT_dma_tx_left(&dev) != 0);
+ */
+uint32_t BT_dma_tx_left(hc05_dev *dev) {
+	return IORD_32DIRECT(dev->base, BLT_DMA_TX_LEN);
+}
+
+/*
+ * Returns the amount of bytes the RX DMA channel still has to receive.
+ * name: BT_dma_rx_left
+ * @param dev  : The HC05 device struct.
+ * @return the amount of bytes left, 0 when the channel is idle.
+ *
+ * example: while(BT_dma_rx_left(&dev) != 0);
+ */
+uint32_t BT_dma_rx_left(hc05_dev *dev) {
+	return IORD_32DIRECT(dev->base, BLT_DMA_RX_LEN);
+}
+
+/*
+ * Stop DMA transfers, without raising their done interrupt. The bytes already
+ * moved stay in the FIFO_out / the receive buffer.
+ * name: BT_dma_abort
+ * @param dev      : The HC05 device struct,
+ *        channels : BLT_I_PENDING_DMA_TX and/or BLT_I_PENDING_DMA_RX.
+ * @return void
+ *
+ * example: BT_dma_abort(&dev, BLT_I_PENDING_DMA_RX);
+ */
+void BT_dma_abort(hc05_dev *dev, uint32_t channels) {
+	if(channels & BLT_I_PENDING_DMA_TX) {
+		IOWR_32DIRECT(dev->base, BLT_DMA_TX_LEN, 0);
+	}
+	if(channels & BLT_I_PENDING_DMA_RX) {
+		IOWR_32DIRECT(dev->base, BLT_DMA_RX_LEN, 0);
+	}
+}
+
+/*
+ * Enable the DMA done interrupts, keeping the other CTRL bits. BT_isr must be
+ * registered, it sets dma_done and calls callback at the end of each transfer.
+ * name: BT_dma_irq_enable
+ * @param dev      : The HC05 device struct,
+ *        callback : called from BT_isr, NULL for none,
+ *        arg      : first argument of callback.
+ * @return void
+ *
+ * example: BT_dma_irq_enable(&dev, NULL, NULL);
+ * BT_send_dma(&dev, frame, 9600);
+ * while(!(dev.dma_done & BLT_I_PENDING_DMA_TX)) { do something else }
+ */
+void BT_dma_irq_enable(hc05_dev *dev, hc05_dma_callback callback, void *arg) {
+	dev->dma_callback = callback;
+	dev->dma_arg = arg;
+	BT_set_CTRL(dev, BT_get_CTRL(dev) | BLT_I_ENABLE_DMA_TX | BLT_I_ENABLE_DMA_RX);
+}
+
+/*
+ * Read the counters of the extension and of the driver. The extension counts
+ * (32 bits, wrapping) since reset or BT_clear_stats.
+ * name: BT_get_stats
+ * @param dev   : The HC05 device struct,
+ *        stats : receives the counters.
+ * @return void
+ *
+ * example: hc05_stats stats;
+ * BT_get_stats(&dev, &stats);
+ * if(stats.fifo_in_high == BT_get_fifo_in_depth(&dev)) //read more often
+ */
+void BT_get_stats(hc05_dev *dev, hc05_stats *stats) {
+	uint32_t high = IORD_32DIRECT(dev->base, BLT_FIFO_HIGH_WATER);
+	stats->tx_bytes = IORD_32DIRECT(dev->base, BLT_TX_COUNT);
+	stats->rx_bytes = IORD_32DIRECT(dev->base, BLT_RX_COUNT);
+	stats->rx_dropped = IORD_32DIRECT(dev->base, BLT_DROP_COUNT);
+	stats->parity_errors = IORD_32DIRECT(dev->base, BLT_PARITY_ERRORS);
+	stats->fifo_in_high = high & BLT_HIGH_WATER_IN_MASK;
+	stats->fifo_out_high = (high & BLT_HIGH_WATER_OUT_MASK) >> BLT_HIGH_WATER_OUT_SHIFT;
+	stats->ring_full = dev->rx.full;
+	stats->tx_busy_cycles = IORD_32DIRECT(dev->base, BLT_TX_BUSY_CYCLES);
+	stats->tx_gap_cycles = IORD_32DIRECT(dev->base, BLT_TX_GAP_CYCLES);
+	stats->sw = dev->stats;
+}
+
+/*
+ * Clear the counters of the extension and of the driver.
+ * name: BT_clear_stats
+ * @param dev  : The HC05 device struct.
+ * @return void
+ *
+ * example: BT_clear_stats(&dev);
+ */
+void BT_clear_stats(hc05_dev *dev) {
+	IOWR_32DIRECT(dev->base, BLT_TX_COUNT, 0);
+	IOWR_32DIRECT(dev->base, BLT_RX_COUNT, 0);
+	IOWR_32DIRECT(dev->base, BLT_DROP_COUNT, 0);
+	IOWR_32DIRECT(dev->base, BLT_PARITY_ERRORS, 0);
+	IOWR_32DIRECT(dev->base, BLT_FIFO_HIGH_WATER, 0);
+	IOWR_32DIRECT(dev->base, BLT_TX_BUSY_CYCLES, 0);
+	IOWR_32DIRECT(dev->base, BLT_TX_GAP_CYCLES, 0);
+	memset(&dev->stats, 0, sizeof(dev->stats));
+	dev->rx.full = 0;
+}
+
+/*
+ * Line utilisation of BLT_Tx while bytes were queued : the cycles spent
+ * sending frames over those plus the cycles a byte waited with the line idle
+ * (flow control, UART off, the first byte of a burst). Frames are sent back to
+ * back, a burst only loses the cycle its first byte is fetched.
+ * name: BT_line_usage
+ * @param stats : counters read by BT_get_stats, cleared before the burst
+ *                (the cycle counters wrap after 2^32 clock cycles).
+ * @return the utilisation in 1/1000, 1000 if nothing was sent.
+ *
+ * example: BT_clear_stats(&dev);
+ * BT_send_message(&dev, frame, 512);
+ * ... BT_get_stats(&dev, &stats);
+ * printf("%u/1000\n", BT_line_usage(&stats)); //999/1000
+ */
+uint32_t BT_line_usage(const hc05_stats *stats) {
+	uint64_t total = (uint64_t) stats->tx_busy_cycles + stats->tx_gap_cycles;
+	return total != 0 ? stats->tx_busy_cycles * (uint64_t) 1000 / total : 1000;
+}
+
+#ifdef BT_STATS
+/* cycles of BT_CYCLES in microseconds */
+static uint64_t cycles_us(hc05_dev *dev, uint64_t cycles) {
+	uint32_t hz = BT_CYCLES_HZ(dev);
+	return hz != 0 ? cycles * 1000000 / hz : 0;
+}
+
+/*
+ * Print the counters of BT_get_stats, to find where the throughput is lost :
+ * drops and high levels near the depth call for faster reads or flow control,
+ * parity errors for another baud rate, refused sends and long waits for a
+ * faster link or less polling, BLT_Tx idle with data to flow control holding
+ * the frames. Built with BT_STATS only, as it brings in printf.
+ * name: BT_dump_stats
+ * @param dev  : The HC05 device struct.
+ * @return void
+ *
+ * example: BT_dump_stats(&dev);
+ * //tx 1200 bytes, FIFO_out high 1024/1024, 37 sends refused, 8120 us stalled
+ */
+void BT_dump_stats(hc05_dev *dev) {
+	hc05_stats stats;
+	BT_get_stats(dev, &stats);
+	printf("rx %" PRIu32 " bytes, %" PRIu32 " dropped (FIFO_in full), ring full %"
+		PRIu32 " times, %" PRIu32 " parity errors\n", stats.rx_bytes,
+		stats.rx_dropped, stats.ring_full, stats.parity_errors);
+	printf("FIFO_in high %" PRIu32 "/%" PRIu32 ", %" PRIu32 " waits spinning %"
+		PRIu64 " us (%" PRIu64 " polls)\n", stats.fifo_in_high,
+		BT_get_fifo_in_depth(dev), stats.sw.wait_calls,
+		cycles_us(dev, stats.sw.wait_cycles), stats.sw.wait_polls);
+	printf("tx %" PRIu32 " bytes, FIFO_out high %" PRIu32 "/%" PRIu32 ", %" PRIu32
+		" sends refused, %" PRIu64 " us stalled\n", stats.tx_bytes,
+		stats.fifo_out_high, BT_get_fifo_out_depth(dev), stats.sw.tx_refused,
+		cycles_us(dev, stats.sw.tx_stall_cycles));
+	uint32_t usage = BT_line_usage(&stats);
+	printf("BLT_Tx busy %" PRIu32 " cycles, idle with data %" PRIu32 " cycles, %"
+		PRIu32 ".%" PRIu32 "%% used, %" PRIu32 " cycles per frame\n",
+		stats.tx_busy_cycles, stats.tx_gap_cycles, usage / 10, usage % 10,
+		stats.tx_bytes != 0 ? stats.tx_busy_cycles / stats.tx_bytes : 0);
+}
+#endif /* BT_STATS */
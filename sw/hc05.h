@@ -13,13 +13,38 @@
 #define BLT_FIFO_IN_DATA 5*4
 #define BLT_FIFO_IN_PENDING_DATA 6*4
 #define BLT_RESET_FIFO 7*4
+#define BLT_TX_WATERMARK 8*4
+#define BLT_FIFO_OUT_DATA32 9*4
+#define BLT_FIFO_IN_DATA32 10*4
+#define BLT_CRC_OUT 11*4
+#define BLT_CRC_IN 12*4
+#define BLT_DMA_TX_ADDR 13*4
+#define BLT_DMA_TX_LEN 14*4
+#define BLT_DMA_RX_ADDR 15*4
+#define BLT_DMA_RX_LEN 16*4
+#define BLT_CAPS 17*4
+#define BLT_RX_WATERMARK 18*4
+#define BLT_RX_TIMEOUT 19*4
+#define BLT_UART_BAUD_FRAC 20*4
+#define BLT_RTS_THRESHOLD 21*4
+#define BLT_TX_COUNT 22*4
+#define BLT_RX_COUNT 23*4
+#define BLT_DROP_COUNT 24*4
+#define BLT_PARITY_ERRORS 25*4
+#define BLT_FIFO_HIGH_WATER 26*4
+#define BLT_TX_BUSY_CYCLES 27*4
+#define BLT_TX_GAP_CYCLES 28*4
 
 //CTRL DEFINES
 #define BLT_UART_ON 0b1
 #define BLT_UART_OFF 0
-#define BLT_I_ENABLE_MASK 0b110
+#define BLT_I_ENABLE_MASK 0b1111000110
 #define BLT_I_ENABLE_RCV 0b10
 #define BLT_I_ENABLE_DROP 0b100
+#define BLT_I_ENABLE_TX_LOW 0b1000000
+#define BLT_I_ENABLE_DMA_TX 0b10000000
+#define BLT_I_ENABLE_DMA_RX 0b100000000
+#define BLT_I_ENABLE_RX_IDLE 0b1000000000
 #define BLT_STOP_MASK 0b1000
 #define BLT_STOP_0 0
 #define BLT_STOP_1 0b1000
@@ -27,22 +52,122 @@
 #define BLT_NO_PARITY 0
 #define BLT_EVEN_PARITY 0b100000
 #define BLT_ODD_PARITY 0b110000
+#define BLT_FRAC_BAUD 0b10000000000
+#define BLT_RX_OVERSAMPLE 0b100000000000
+#define BLT_FLOW_CTRL 0b1000000000000
 
 //STATUS DEFINES
-#define BLT_I_PENDING_MASK 0b11
+#define BLT_I_PENDING_MASK 0b111111
 #define BLT_I_PENDING_RCV 0b1
 #define BLT_I_PENDING_DROP 0b10
+#define BLT_I_PENDING_TX_LOW 0b100
+#define BLT_I_PENDING_DMA_TX 0b1000
+#define BLT_I_PENDING_DMA_RX 0b10000
+#define BLT_I_PENDING_RX_IDLE 0b100000
+
+//FIFO_IN_PENDING_DATA DEFINES
+#define BLT_FIFO_IN_PENDING_MASK 0x7fff
+#define BLT_FIFO_IN_LAST_COUNT_MASK 0xe0000000
+#define BLT_FIFO_IN_LAST_COUNT_SHIFT 29
+
+//CAPS DEFINES
+#define BLT_CAPS_FIFO_OUT_LOG2_MASK 0x1f
+#define BLT_CAPS_FIFO_IN_LOG2_MASK 0x1f00
+#define BLT_CAPS_FIFO_IN_LOG2_SHIFT 8
+#define BLT_CAPS_CRC 0x10000
+#define BLT_CAPS_DMA 0x20000
+
+//FIFO_HIGH_WATER DEFINES
+#define BLT_HIGH_WATER_IN_MASK 0x7fff
+#define BLT_HIGH_WATER_OUT_MASK 0x7fff0000
+#define BLT_HIGH_WATER_OUT_SHIFT 16
 
 //RESET DEFINES
 #define BLT_RESET_FIFO_IN 0b1
 #define BLT_RESET_FIFO_OUT 0b10
 
+//BT_read_line RETURN DEFINES
+#define BT_LINE_NONE -1
+#define BT_LINE_TOO_LONG -2
+
+
+/* piece of a message, for BT_sendv and BT_tx_enqueuev */
+typedef struct bt_iov {
+    const char *base;   /* Start of the piece */
+    uint32_t length;    /* Length of the piece */
+} bt_iov;
+
+/* receive ring buffer, filled by BT_isr */
+typedef struct {
+    char *buffer;               /* Storage given by the user */
+    uint32_t size;              /* Size of buffer, power of two */
+    volatile uint32_t head;     /* Write index, only moved by BT_isr */
+    volatile uint32_t tail;     /* Read index, only moved by BT_rx_read */
+    volatile uint32_t held;     /* Ring full, BT_isr left the FIFO_in alone */
+    volatile uint32_t full;     /* Times the ring filled up */
+    volatile uint32_t i_dropped;/* i_dropped interrupts, FIFO_in was full */
+} hc05_rx_ring;
+
+/* transmit queue, moved to the FIFO_out by BT_isr */
+typedef struct {
+    char *buffer;               /* Storage given by the user */
+    uint32_t size;              /* Size of buffer, power of two */
+    volatile uint32_t head;     /* Write index, only moved by BT_tx_enqueue */
+    volatile uint32_t tail;     /* Read index, moved by the refill */
+} hc05_tx_ring;
+
+/* called by BT_isr at the end of DMA transfers, done holds
+ * BLT_I_PENDING_DMA_TX and/or BLT_I_PENDING_DMA_RX */
+typedef void (*hc05_dma_callback)(void *arg, uint32_t done);
+
+/* driver counters, the times in cycles of BT_CYCLES. Only counted when the
+ * driver is built with BT_STATS (HAL timestamp timer on the Nios), all zero
+ * otherwise : the sends and waits then pay nothing for them */
+typedef struct {
+    uint32_t tx_refused;        /* Sends refused, not enough FIFO_out space */
+    uint64_t tx_stall_cycles;   /* From a refused send to the next accepted */
+    uint64_t tx_stall_start;    /* Time of the first refused send */
+    int tx_stalled;             /* A send was refused since the last accepted */
+    uint32_t wait_calls;        /* BT_wait_for_data calls that had to spin */
+    uint64_t wait_polls;        /* FIFO_in_pending_data reads while spinning */
+    uint64_t wait_cycles;       /* Time spent spinning in BT_wait_for_data */
+} hc05_sw_stats;
+
+/* link counters of the extension and of the driver, see BT_get_stats */
+typedef struct {
+    uint32_t tx_bytes;          /* Frames started on BLT_Tx */
+    uint32_t rx_bytes;          /* Bytes written to the FIFO_in */
+    uint32_t rx_dropped;        /* Bytes lost, FIFO_in full (i_dropped) */
+    uint32_t parity_errors;     /* Frames rejected for their parity bit */
+    uint32_t fifo_in_high;      /* Highest FIFO_in level */
+    uint32_t fifo_out_high;     /* Highest FIFO_out level */
+    uint32_t ring_full;         /* Times the receive ring filled up */
+    uint32_t tx_busy_cycles;    /* Clock cycles with a frame on BLT_Tx */
+    uint32_t tx_gap_cycles;     /* Clock cycles with a byte ready, BLT_Tx idle */
+    hc05_sw_stats sw;
+} hc05_stats;
 
 /* hc05 device structure */
 typedef struct {
     void *base; /* Base address of component */
+    hc05_rx_ring rx;
+    hc05_tx_ring tx;
+    hc05_sw_stats stats;
+    volatile uint32_t dma_done;     /* DMA channels done, set by BT_isr */
+    hc05_dma_callback dma_callback; /* Optional, see BT_dma_irq_enable */
+    void *dma_arg;
 } hc05_dev;
 
+/* "\r\n" terminated line reader, see BT_line_init */
+typedef struct {
+    hc05_dev *dev;
+    char *buffer;       /* Storage given by the user */
+    uint32_t size;      /* Size of buffer, longest line + 2 */
+    uint32_t start;     /* First byte not returned yet */
+    uint32_t end;       /* End of the bytes received */
+    uint32_t scanned;   /* No "\r\n" ends before this index */
+} bt_line_reader;
+
 /*******************************************************************************
  *  Public API
  ******************************************************************************/
@@ -57,18 +182,34 @@ baud_rate BT_get_baud_rate(hc05_dev *dev);
 
 void BT_set_baud_rate(hc05_dev *dev, baud_rate rate);
 
+uint32_t BT_get_baud_frac(hc05_dev *dev);
+
+void BT_set_baud_frac(hc05_dev *dev, uint32_t frac);
+
 uint32_t BT_get_i_pending(hc05_dev *dev);
 
 void BT_clear_i_pending(hc05_dev *dev);
 
+void BT_ack_i_pending(hc05_dev *dev, uint32_t mask);
+
 uint32_t BT_get_free_space(hc05_dev *dev);
 
+uint32_t BT_get_caps(hc05_dev *dev);
+
+uint32_t BT_get_fifo_out_depth(hc05_dev *dev);
+
+uint32_t BT_get_fifo_in_depth(hc05_dev *dev);
+
 void BT_send_word(hc05_dev *dev, char word);
 
+void BT_write_FIFO_out(hc05_dev *dev, const char *data, uint32_t length);
+
 int BT_send_word_safe(hc05_dev *dev, char word);
 
 int BT_send_message(hc05_dev *dev, char* message, uint32_t length);
 
+int BT_sendv(hc05_dev *dev, const bt_iov *iov, uint32_t count);
+
 int BT_send_command(hc05_dev *dev, char* message, uint32_t length);
 
 uint32_t BT_get_pending_data(hc05_dev *dev);
@@ -79,12 +220,81 @@ char BT_get_data(hc05_dev *dev);
 
 int BT_get_data_safe(hc05_dev *dev, char* data);
 
+void BT_read_FIFO_in(hc05_dev *dev, char *data, uint32_t amount);
+
 void BT_get_amount_data(hc05_dev *dev, char *data, uint32_t amount);
 
+int BT_read(hc05_dev *dev, char *data, uint32_t max);
+
 int BT_get_all_data(hc05_dev *dev, char *data);
 
 int BT_get_data_terminator(hc05_dev *dev, char *data);
 
+void BT_line_init(bt_line_reader *reader, hc05_dev *dev, char *buffer,
+		uint32_t size);
+
+int BT_read_line(bt_line_reader *reader, char *line, uint32_t max);
+
 void BT_reset_FIFO(hc05_dev *dev, uint32_t val);
 
+int BT_rx_ring_init(hc05_dev *dev, char *buffer, uint32_t size);
+
+void BT_rx_irq_enable(hc05_dev *dev);
+
+void BT_rx_irq_disable(hc05_dev *dev);
+
+void BT_set_rx_watermark(hc05_dev *dev, uint32_t level);
+
+void BT_set_rx_timeout(hc05_dev *dev, uint32_t bit_times);
+
+void BT_set_rts_threshold(hc05_dev *dev, uint32_t level);
+
+void BT_set_flow_control(hc05_dev *dev, int on);
+
+void BT_isr(void *context);
+
+uint32_t BT_rx_available(hc05_dev *dev);
+
+uint32_t BT_rx_read(hc05_dev *dev, char *data, uint32_t max);
+
+int BT_tx_ring_init(hc05_dev *dev, char *buffer, uint32_t size);
+
+void BT_set_tx_watermark(hc05_dev *dev, uint32_t level);
+
+int BT_tx_enqueue(hc05_dev *dev, const char *data, uint32_t length);
+
+int BT_tx_enqueuev(hc05_dev *dev, const bt_iov *iov, uint32_t count);
+
+uint32_t BT_tx_pending(hc05_dev *dev);
+
+void BT_set_crc_out(hc05_dev *dev, uint16_t seed);
+
+uint16_t BT_get_crc_out(hc05_dev *dev);
+
+void BT_set_crc_in(hc05_dev *dev, uint16_t seed);
+
+uint16_t BT_get_crc_in(hc05_dev *dev);
+
+int BT_send_dma(hc05_dev *dev, const void *buffer, uint32_t length);
+
+int BT_recv_dma(hc05_dev *dev, void *buffer, uint32_t length);
+
+uint32_t BT_dma_tx_left(hc05_dev *dev);
+
+uint32_t BT_dma_rx_left(hc05_dev *dev);
+
+void BT_dma_abort(hc05_dev *dev, uint32_t channels);
+
+void BT_dma_irq_enable(hc05_dev *dev, hc05_dma_callback callback, void *arg);
+
+void BT_get_stats(hc05_dev *dev, hc05_stats *stats);
+
+void BT_clear_stats(hc05_dev *dev);
+
+#ifdef BT_STATS
+void BT_dump_stats(hc05_dev *dev);
+#endif
+
+uint32_t BT_line_usage(const hc05_stats *stats);
+
 #endif /* HC_05_H_ */
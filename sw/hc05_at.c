@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hc05_at.h"
+#define BT_USE_TIME_US
+#define BT_USE_DELAY_US
+#include "hc05_time.h"
+
+#define BT_AT_POLL_US 100
+
+static uint32_t cmd_timeout(const bt_at_cmd *cmd) {
+	return cmd->timeout_us != 0 ? cmd->timeout_us : BT_AT_DEFAULT_TIMEOUT;
+}
+
+/* parse one answer line into result. Returns 1 if it is a final answer */
+static int parse_line(bt_at_result *result, const char *line) {
+	if(line[0] == '\0') {
+		return 0;
+	}
+	if(strcmp(line, "OK") == 0) {
+		result->status = BT_AT_OK;
+		return 1;
+	}
+	if(strncmp(line, "ERROR", 5) == 0 || strcmp(line, "FAIL") == 0) {
+		const char *code = strchr(line, '(');
+		result->status = BT_AT_ERROR;
+		result->error = code != NULL ? (int) strtol(code + 1, NULL, 16) : -1;
+		return 1;
+	}
+	if(line[0] == '+') {
+		const char *colon = strchr(line, ':');
+		uint32_t key = colon != NULL ? (uint32_t) (colon - line - 1) : strlen(line + 1);
+		if(key > BT_AT_MAX_KEY - 1) {
+			key = BT_AT_MAX_KEY - 1;
+		}
+		memcpy(result->key, line + 1, key);
+		result->key[key] = '\0';
+		snprintf(result->value, BT_AT_MAX_VALUE, "%s", colon != NULL ? colon + 1 : "");
+		return 0;
+	}
+	result->status = BT_AT_GARBLED;
+	return 1;
+}
+
+/*
+ * Initialize a command engine.
+ * name: BT_at_init
+ * @param at     : The engine to initialize,
+ *        dev    : The HC05 device struct, talking to the module in AT mode,
+ *        window : how many commands may be waiting for their answer, 1 to
+ *                 send each command once the previous one is answered.
+ * @return void
+ *
+ * example: bt_at_engine at;
+ * BT_at_init(&at, &dev, 4);
+ */
+void BT_at_init(bt_at_engine *at, hc05_dev *dev, uint32_t window) {
+	memset(at, 0, sizeof(*at));
+	at->dev = dev;
+	at->window = window != 0 ? window : 1;
+}
+
+/*
+ * Start a batch of commands : the FIFO_in is emptied, the results cleared,
+ * and the first commands are sent by the next BT_at_poll.
+ * name: BT_at_start
+ * @param at    : The command engine,
+ *        cmds  : the commands, they must stay valid until the batch ends,
+ *        count : the amount of commands.
+ * @return void
+ *
+ * example: BT_at_start(&at, cmds, sizeof(cmds) / sizeof(cmds[0]));
+ */
+void BT_at_start(bt_at_engine *at, bt_at_cmd *cmds, uint32_t count) {
+	for(uint32_t i = 0; i < count; ++i) {
+		memset(&cmds[i].result, 0, sizeof(cmds[i].result));
+		cmds[i].result.status = BT_AT_IDLE;
+		cmds[i].result.error = -1;
+	}
+	at->cmds = cmds;
+	at->count = count;
+	at->sent = 0;
+	at->done = 0;
+	BT_line_init(&at->reader, at->dev, at->rx_buffer, sizeof(at->rx_buffer));
+	BT_reset_FIFO(at->dev, BLT_RESET_FIFO_IN);
+	at->start_us = BT_TIME_US(at->dev);
+	at->end_us = at->start_us;
+}
+
+/*
+ * Move the batch forward without waiting : send the commands the window
+ * allows, parse the answers received and check the timeout of the oldest
+ * command sent.
+ * name: BT_at_poll
+ * @param at : The command engine.
+ * @return BT_AT_RUNNING while commands are left, BT_AT_DONE once all the
+ *          commands were answered "OK", BT_AT_FAILED if one was not : it is
+ *          at->cmds[at->done], its result tells why.
+ *
+ * example: while(BT_at_poll(&at) == BT_AT_RUNNING) {
+ *     //something else
+ * }
+ */
+int BT_at_poll(bt_at_engine *at) {
+	uint64_t now = BT_TIME_US(at->dev);
+	int answered;
+	char line[BT_AT_MAX_LINE];
+	if(at->done == at->count) {
+		return BT_AT_DONE;
+	}
+	if(at->cmds[at->done].result.status > BT_AT_OK) {
+		return BT_AT_FAILED;
+	}
+	do {
+		answered = 0;
+		while(at->sent < at->count && at->sent - at->done < at->window) {
+			bt_at_cmd *cmd = &at->cmds[at->sent];
+			if(BT_send_command(at->dev, (char *) cmd->cmd, strlen(cmd->cmd)) == -1) {
+				break; //FIFO_out full, next poll
+			}
+			cmd->result.status = BT_AT_SENT;
+			if(at->sent == at->done) {
+				at->deadline = now + cmd_timeout(cmd);
+			}
+			++at->sent;
+		}
+		while(!answered && at->done < at->sent) {
+			int length = BT_read_line(&at->reader, line, sizeof(line));
+			if(length == BT_LINE_NONE) {
+				break;
+			}
+			bt_at_result *result = &at->cmds[at->done].result;
+			if(length == BT_LINE_TOO_LONG) {
+				result->status = BT_AT_GARBLED;
+			} else if(!parse_line(result, line)) {
+				continue;
+			}
+			if(result->status != BT_AT_OK) {
+				at->end_us = now;
+				return BT_AT_FAILED;
+			}
+			answered = 1;
+			if(++at->done < at->sent) {
+				at->deadline = now + cmd_timeout(&at->cmds[at->done]);
+			}
+		}
+	} while(answered && at->done < at->count);
+	if(at->done == at->count) {
+		at->end_us = now;
+		return BT_AT_DONE;
+	}
+	if(at->done < at->sent && now >= at->deadline) {
+		at->cmds[at->done].result.status = BT_AT_TIMEOUT;
+		at->end_us = now;
+		return BT_AT_FAILED;
+	}
+	return BT_AT_RUNNING;
+}
+
+/*
+ * Run a batch of commands to its end.
+ * name: BT_at_run
+ * @param at    : The command engine,
+ *        cmds  : the commands,
+ *        count : the amount of commands.
+ * @return BT_AT_DONE if all the commands were answered "OK", BT_AT_FAILED
+ *          otherwise (see BT_at_poll).
+ *
+ * example: bt_at_cmd cmds[] = {
+ *     {"AT+UART=115200,0,0"}, {"AT+CMODE=0"}, {"AT+ROLE=1"},
+ *     {"AT+BIND=98d3,32,707966"}, {"AT+RESET"}
+ * };
+ * if(BT_at_run(&at, cmds, 5) == BT_AT_FAILED) {
+ *     printf("%s failed\n", cmds[at.done].cmd);
+ * }
+ * printf("%" PRIu32 " us\n", BT_at_elapsed_us(&at));
+ */
+int BT_at_run(bt_at_engine *at, bt_at_cmd *cmds, uint32_t count) {
+	int ret;
+	BT_at_start(at, cmds, count);
+	while((ret = BT_at_poll(at)) == BT_AT_RUNNING) {
+		BT_DELAY_US(at->dev, BT_AT_POLL_US);
+	}
+	return ret;
+}
+
+/*
+ * Returns the time taken by the batch, from BT_at_start to its end (or to
+ * now while it runs).
+ * name: BT_at_elapsed_us
+ * @param at : The command engine.
+ * @return the time in microseconds.
+ *
+ * example: uint32_t us = BT_at_elapsed_us(&at);
+ */
+uint32_t BT_at_elapsed_us(bt_at_engine *at) {
+	if(at->done < at->count && at->cmds[at->done].result.status <= BT_AT_SENT) {
+		return BT_TIME_US(at->dev) - at->start_us;
+	}
+	return at->end_us - at->start_us;
+}
+
+/*
+ * Send one command and wait for its answer.
+ * name: BT_at_command
+ * @param dev        : The HC05 device struct, in AT mode,
+ *        cmd        : the command without "\r\n",
+ *        timeout_us : how long to wait for the answer, 0 for BT_AT_DEFAULT_TIMEOUT,
+ *        result     : if not NULL, receives the parsed answer.
+ * @return 0 if the module answered "OK", -1 otherwise.
+ *
+ * example: bt_at_result addr;
+ * if(BT_at_command(&dev, "AT+ADDR?", 0, &addr) == 0) {
+ *     printf("%s\n", addr.value); //98d3:32:707966
+ * }
+ */
+int BT_at_command(hc05_dev *dev, const char *cmd, uint32_t timeout_us,
+		bt_at_result *result) {
+	bt_at_engine at;
+	bt_at_cmd command;
+	command.cmd = cmd;
+	command.timeout_us = timeout_us;
+	BT_at_init(&at, dev, 1);
+	int ret = BT_at_run(&at, &command, 1);
+	if(result != NULL) {
+		*result = command.result;
+	}
+	return ret == BT_AT_DONE ? 0 : -1;
+}
+
+/*
+ * Wait for the module to answer "AT" at the current baud rate, after power up
+ * or a reset in AT mode, instead of sleeping for a fixed time.
+ * name: BT_wait_ready
+ * @param dev        : The HC05 device struct (UART on),
+ *        timeout_us : how long the module may take.
+ * @return the time the module took in microseconds, -1 if it did not answer.
+ *
+ * example: i2c_pio_writebit(&pio, BIT_BLT_EN, 1);
+ * if(BT_wait_ready(&dev, 2000000) == -1) //module dead, or another baud rate
+ */
+int BT_wait_ready(hc05_dev *dev, uint32_t timeout_us) {
+	uint64_t start = BT_TIME_US(dev);
+	uint64_t now = start;
+	while(now - start < timeout_us) {
+		if(BT_at_command(dev, "AT", BT_AT_PROBE_TIMEOUT, NULL) == 0) {
+			return BT_TIME_US(dev) - start;
+		}
+		//garbage from a booting module comes back at once, don't flood it
+		BT_DELAY_US(dev, BT_AT_POLL_US);
+		now = BT_TIME_US(dev);
+	}
+	return -1;
+}
+
+/*
+ * Wait for the first byte received in data mode, the link being up. The byte
+ * is left in the FIFO_in, or in the receive ring buffer if BT_isr runs.
+ * name: BT_wait_link
+ * @param dev        : The HC05 device struct,
+ *        timeout_us : how long to wait.
+ * @return the time waited in microseconds, -1 if nothing was received.
+ *
+ * example: int us = BT_wait_link(&dev, 30000000);
+ */
+int BT_wait_link(hc05_dev *dev, uint32_t timeout_us) {
+	uint64_t start = BT_TIME_US(dev);
+	uint64_t now = start;
+	while(BT_get_pending_data(dev) == 0
+			&& (dev->rx.buffer == NULL || BT_rx_available(dev) == 0)) {
+		if(now - start >= timeout_us) {
+			return -1;
+		}
+		BT_DELAY_US(dev, BT_AT_POLL_US);
+		now = BT_TIME_US(dev);
+	}
+	return now - start;
+}
+
+/*
+ * Leave AT mode : send AT+RESET, move the extension to the data mode rate with
+ * empty FIFOs, and wait for the link with BT_wait_link. The KEY pin of the
+ * module (BIT_BLT_ATSel) must be low before.
+ * name: BT_reconnect
+ * @param dev        : The HC05 device struct, in AT mode,
+ *        rate       : the data mode rate, set by AT+UART,
+ *        timeout_us : how long to wait for the link, 0 not to wait (the
+ *                     remote side may only listen).
+ * @return the time from AT+RESET to the link in microseconds (0 if not
+ *          waited), -1 if AT+RESET failed or no link came up.
+ *
+ * example: i2c_pio_writebit(&pio, BIT_BLT_ATSel, 0);
+ * int us = BT_reconnect(&dev, b115200, 30000000);
+ */
+int BT_reconnect(hc05_dev *dev, baud_rate rate, uint32_t timeout_us) {
+	uint64_t start = BT_TIME_US(dev);
+	if(BT_at_command(dev, "AT+RESET", 0, NULL) != 0) {
+		return -1;
+	}
+	BT_reset_FIFO(dev, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
+	BT_set_baud_rate(dev, rate);
+	if(timeout_us == 0) {
+		return 0;
+	}
+	if(BT_wait_link(dev, timeout_us) == -1) {
+		return -1;
+	}
+	return BT_TIME_US(dev) - start;
+}
@@ -0,0 +1,106 @@
+#ifndef HC_05_AT_H_
+#define HC_05_AT_H_
+
+#include <stdint.h>
+#include "hc05.h"
+
+/*
+ * AT command engine for the HC05 module in AT mode.
+ *
+ * A batch of commands is run by a state machine polled with BT_at_poll : it
+ * never waits, so the caller can do something else in between. Up to window
+ * commands are written to the FIFO_out ahead of their answers, the module
+ * answering them in order. Each command gets its own timeout, started when it
+ * becomes the oldest command waiting for an answer, and its answer is parsed
+ * into a bt_at_result :
+ *   "OK"          -> BT_AT_OK
+ *   "ERROR:(n)"   -> BT_AT_ERROR, error = n (hexadecimal)
+ *   "FAIL"        -> BT_AT_ERROR, error = -1
+ *   "+KEY:value"  -> key and value kept, the final "OK" or error still awaited
+ *   other lines   -> BT_AT_GARBLED (wrong baud rate, noise, too long)
+ * The batch stops at the first command not answered "OK", the commands of
+ * the window after it may already be sent.
+ * Times come from BT_TIME_US (alt_nticks on the Nios, the BSP needs a
+ * sys_clk_timer), in microseconds.
+ *
+ * BT_wait_ready replaces fixed delays at power up : it probes with "AT" and
+ * returns as soon as the module answers. BT_reconnect resets the module into
+ * data mode and BT_wait_link waits for its first received byte, the sign that
+ * the link is up.
+ */
+
+#define BT_AT_DEFAULT_TIMEOUT 1000000 /* us, default timeout of a command */
+#define BT_AT_MAX_LINE 64       /* longest answer line kept */
+#define BT_AT_MAX_KEY 16
+#define BT_AT_MAX_VALUE 48
+#define BT_AT_PROBE_TIMEOUT 20000 /* us, answer to a readiness "AT" */
+
+//BT_at_poll RETURN DEFINES
+#define BT_AT_DONE 0
+#define BT_AT_RUNNING 1
+#define BT_AT_FAILED -1
+
+/* state of a command */
+typedef enum {
+    BT_AT_IDLE,         /* Not sent yet */
+    BT_AT_SENT,         /* Written to the FIFO_out, waiting for the answer */
+    BT_AT_OK,           /* Answered "OK" */
+    BT_AT_ERROR,        /* Answered "ERROR:(n)" or "FAIL" */
+    BT_AT_TIMEOUT,      /* No final answer in time */
+    BT_AT_GARBLED       /* Answered something that is not AT syntax */
+} bt_at_status;
+
+/* parsed answer of a command */
+typedef struct {
+    bt_at_status status;
+    int error;                  /* n of "ERROR:(n)", -1 otherwise */
+    char key[BT_AT_MAX_KEY];    /* KEY of the last "+KEY:value", "" if none */
+    char value[BT_AT_MAX_VALUE];/* value of the last "+KEY:value" */
+} bt_at_result;
+
+/* command of a batch */
+typedef struct {
+    const char *cmd;            /* Command without "\r\n", e.g. "AT+ROLE=1" */
+    uint32_t timeout_us;        /* 0 for BT_AT_DEFAULT_TIMEOUT */
+    bt_at_result result;
+} bt_at_cmd;
+
+/* command engine structure */
+typedef struct {
+    hc05_dev *dev;
+    uint32_t window;            /* Commands written ahead of their answers */
+    bt_at_cmd *cmds;
+    uint32_t count;
+    uint32_t sent;              /* Commands written to the FIFO_out */
+    uint32_t done;              /* Commands answered, cmds[done] is awaited */
+    uint64_t deadline;          /* Timeout of cmds[done] */
+    uint64_t start_us;          /* BT_at_start time */
+    uint64_t end_us;            /* Time the batch ended */
+    bt_line_reader reader;      /* Answers, see BT_read_line */
+    char rx_buffer[2 * BT_AT_MAX_LINE];
+} bt_at_engine;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+void BT_at_init(bt_at_engine *at, hc05_dev *dev, uint32_t window);
+
+void BT_at_start(bt_at_engine *at, bt_at_cmd *cmds, uint32_t count);
+
+int BT_at_poll(bt_at_engine *at);
+
+int BT_at_run(bt_at_engine *at, bt_at_cmd *cmds, uint32_t count);
+
+uint32_t BT_at_elapsed_us(bt_at_engine *at);
+
+int BT_at_command(hc05_dev *dev, const char *cmd, uint32_t timeout_us,
+		bt_at_result *result);
+
+int BT_wait_ready(hc05_dev *dev, uint32_t timeout_us);
+
+int BT_wait_link(hc05_dev *dev, uint32_t timeout_us);
+
+int BT_reconnect(hc05_dev *dev, baud_rate rate, uint32_t timeout_us);
+
+#endif /* HC_05_AT_H_ */
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "hc05_baud.h"
+#include "hc05_at.h"
+#define BT_USE_DELAY_US
+#include "hc05_time.h"
+
+#define BT_BAUD_POLL_US 100
+
+/* nominal rates of baud_rates.h, fastest first */
+static const struct {
+	baud_rate rate;
+	uint32_t bps;
+} baud_table[] = {
+	{b1382400, 1382400}, {b921600, 921600}, {b460800, 460800},
+	{b230400, 230400}, {b115200, 115200}, {b57600, 57600},
+	{b38400, 38400}, {b19200, 19200}, {b9600, 9600}, {b4800, 4800}
+};
+#define BAUD_TABLE_SIZE (sizeof(baud_table) / sizeof(baud_table[0]))
+
+/* AT mode default first, then the usual data mode rates */
+static const baud_rate probe_order[] = {
+	b38400, b9600, b115200, b57600, b19200, b230400, b460800, b921600,
+	b1382400, b4800
+};
+
+/*
+ * Returns the nominal rate of a baud_rate value.
+ * name: BT_baud_bps
+ * @param rate : a baud_rate of baud_rates.h.
+ * @return the rate in bits/s, 0 if rate is not in baud_rates.h.
+ *
+ * example: uint32_t bps = BT_baud_bps(b115200); //bps = 115200
+ */
+uint32_t BT_baud_bps(baud_rate rate) {
+	for(uint32_t i = 0; i < BAUD_TABLE_SIZE; ++i) {
+		if(baud_table[i].rate == rate) {
+			return baud_table[i].bps;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Set the UART_wait_cycles register for any clock and baud rate, rounded to
+ * the nearest rate the UART can do : to a whole clock cycle per bit, or to
+ * 1/256 cycle with BLT_FRAC_BAUD set in CTRL (UART_baud_frac is written too).
+ * name: BT_set_baud
+ * @param dev    : The HC05 device struct,
+ *        clk_hz : the clock of the HC05 extension,
+ *        bps    : the wanted baud rate,
+ *        error  : if not NULL, receives the error of the rate set against
+ *                 bps, in 1/100 % (-45 is -0.45 %).
+ * @return the baud rate set, 0 if bps is 0 or too fast for clk_hz (at least
+ *          BT_BAUD_MIN_CYCLES+1 cycles per bit, BT_BAUD_MIN_CYCLES_OVERSAMPLE+1
+ *          with BLT_RX_OVERSAMPLE), the registers being left as they were.
+ *
+ * example: int32_t error;
+ * uint32_t bps = BT_set_baud(&dev, 50000000, 2000000, &error);
+ * //bps = 2000000, error = 0
+ * BT_set_CTRL(&dev, BT_get_CTRL(&dev) | BLT_FRAC_BAUD);
+ * bps = BT_set_baud(&dev, 50000000, 3000000, &error);
+ * //bps = 2999766, error = 0 (-0.008 %), 2941176 and -196 without BLT_FRAC_BAUD
+ */
+uint32_t BT_set_baud(hc05_dev *dev, uint32_t clk_hz, uint32_t bps, int32_t *error) {
+	uint32_t ctrl = BT_get_CTRL(dev);
+	uint32_t min = ctrl & BLT_RX_OVERSAMPLE ? BT_BAUD_MIN_CYCLES_OVERSAMPLE
+		: BT_BAUD_MIN_CYCLES;
+	if(bps == 0 || clk_hz / bps < min + 1) {
+		return 0;
+	}
+	//bit period in 1/256 cycles, the fraction is dropped without BLT_FRAC_BAUD
+	uint64_t period = (((uint64_t) clk_hz << 8) + bps / 2) / bps;
+	if(!(ctrl & BLT_FRAC_BAUD)) {
+		period = (((uint64_t) clk_hz + bps / 2) / bps) << 8;
+	}
+	uint32_t real = (((uint64_t) clk_hz << 8) + period / 2) / period;
+	if(error != NULL) {
+		*error = ((int64_t) real - bps) * 10000 / bps;
+	}
+	if(ctrl & BLT_FRAC_BAUD) {
+		BT_set_baud_frac(dev, period & 0xff);
+	}
+	BT_set_baud_rate(dev, (period >> 8) - 1);
+	return real;
+}
+
+/*
+ * Returns the baud rate the UART runs at, from UART_wait_cycles, and
+ * UART_baud_frac if BLT_FRAC_BAUD is set.
+ * name: BT_get_baud
+ * @param dev    : The HC05 device struct,
+ *        clk_hz : the clock of the HC05 extension.
+ * @return the baud rate in bits/s, rounded.
+ *
+ * example: uint32_t bps = BT_get_baud(&dev, BT_CLK_HZ);
+ */
+uint32_t BT_get_baud(hc05_dev *dev, uint32_t clk_hz) {
+	uint64_t period = ((uint64_t) BT_get_baud_rate(dev) + 1) << 8;
+	if(BT_get_CTRL(dev) & BLT_FRAC_BAUD) {
+		period += BT_get_baud_frac(dev) & 0xff;
+	}
+	return (((uint64_t) clk_hz << 8) + period / 2) / period;
+}
+
+/* wait for the FIFO_out to be empty and the last frame to be out */
+static void wait_tx_idle(hc05_dev *dev) {
+	uint32_t depth = BT_get_fifo_out_depth(dev);
+	while(BT_get_free_space(dev) != depth) {
+		BT_DELAY_US(dev, BT_BAUD_POLL_US);
+	}
+	//12 bits : start, 8 data, parity, 2 stop
+	BT_DELAY_US(dev, 12 * BT_get_baud_rate(dev) / (BT_CLK_HZ / 1000000) + 1);
+}
+
+/*
+ * Send "AT" and wait for "OK", at the current baud rate.
+ * name: BT_at_probe
+ * @param dev        : The HC05 device struct,
+ *        timeout_us : how long to wait for the answer.
+ * @return 0 if the module answered "OK", -1 otherwise.
+ *
+ * example: if(BT_at_probe(&dev, BT_BAUD_PROBE_TIMEOUT) == 0) //module talks
+ */
+int BT_at_probe(hc05_dev *dev, uint32_t timeout_us) {
+	return BT_at_command(dev, "AT", timeout_us, NULL);
+}
+
+/*
+ * Find the baud rate of the module : try each rate of baud_rates.h with an
+ * "AT" probe, and leave the extension on the first one answered.
+ * name: BT_autobaud
+ * @param dev        : The HC05 device struct (UART on),
+ *        timeout_us : how long to wait for each answer.
+ * @return the baud_rate found, -1 if the module never answered (the
+ *          extension is left on the last rate tried).
+ *
+ * example: int rate = BT_autobaud(&dev, BT_BAUD_PROBE_TIMEOUT);
+ */
+int BT_autobaud(hc05_dev *dev, uint32_t timeout_us) {
+	for(uint32_t i = 0; i < sizeof(probe_order) / sizeof(probe_order[0]); ++i) {
+		wait_tx_idle(dev);
+		BT_set_baud_rate(dev, probe_order[i]);
+		//a first probe may be garbled by the line settling
+		if(BT_at_probe(dev, timeout_us) == 0 || BT_at_probe(dev, timeout_us) == 0) {
+			return probe_order[i];
+		}
+	}
+	return -1;
+}
+
+/* BT_BAUD_TEST_PROBES probes in a row must pass */
+static int test_rate(hc05_dev *dev) {
+	for(uint32_t i = 0; i < BT_BAUD_TEST_PROBES; ++i) {
+		if(BT_at_probe(dev, BT_BAUD_PROBE_TIMEOUT) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Ask the module for rate with AT+UART, make it use it and switch the
+ * extension. Returns 0, -1 if AT+UART was refused (nothing stored in the
+ * module), -2 if apply failed (rate stored in the module).
+ */
+static int move_to(hc05_dev *dev, baud_rate rate, uint32_t stop,
+		uint32_t parity, hc05_baud_apply apply, void *arg) {
+	char cmd[32];
+	sprintf(cmd, "AT+UART=%" PRIu32 ",%" PRIu32 ",%" PRIu32, BT_baud_bps(rate),
+		stop, parity);
+	if(BT_at_command(dev, cmd, BT_BAUD_PROBE_TIMEOUT, NULL) != 0) {
+		return -1;
+	}
+	if(apply != NULL && apply(dev, arg) != 0) {
+		return -2;
+	}
+	wait_tx_idle(dev);
+	BT_set_baud_rate(dev, rate);
+	return 0;
+}
+
+/*
+ * Move the module and the extension to the fastest rate that works : each
+ * rate from max down to the current one is asked with AT+UART (same stop
+ * bits and parity as CTRL), applied, and tested with BT_BAUD_TEST_PROBES
+ * probes. When a rate stored by AT+UART fails, the module is found again
+ * with BT_autobaud and put back on the start rate (AT+UART and apply again),
+ * so that the rate stored in the module, used in data mode after AT+RESET,
+ * is the one returned. Then the next slower rate is tried.
+ * name: BT_negotiate_baud
+ * @param dev   : The HC05 device struct, talking to the module in AT mode,
+ *        max   : the fastest rate to try,
+ *        apply : makes the module use the rate just accepted, NULL if the
+ *                module switches by itself,
+ *        arg   : first argument of apply.
+ * @return the baud_rate in use and stored in the module at the end,
+ *          -1 if the module was lost or could not be put back on the start
+ *          rate (BT_autobaud finds it, its stored rate is unknown).
+ *
+ * example: BT_autobaud(&dev, BT_BAUD_PROBE_TIMEOUT);
+ * int rate = BT_negotiate_baud(&dev, b1382400, NULL, NULL);
+ */
+int BT_negotiate_baud(hc05_dev *dev, baud_rate max, hc05_baud_apply apply,
+		void *arg) {
+	uint32_t max_bps = BT_baud_bps(max);
+	baud_rate start = BT_get_baud_rate(dev);
+	uint32_t start_bps = BT_baud_bps(start);
+	uint32_t ctrl = BT_get_CTRL(dev);
+	uint32_t stop = (ctrl & BLT_STOP_MASK) == BLT_STOP_1 ? 1 : 0;
+	uint32_t parity = 0;
+	if((ctrl & BLT_PARTITY_MASK) == BLT_ODD_PARITY) {
+		parity = 1;
+	} else if((ctrl & BLT_PARTITY_MASK) == BLT_EVEN_PARITY) {
+		parity = 2;
+	}
+
+	for(uint32_t i = 0; i < BAUD_TABLE_SIZE; ++i) {
+		if(baud_table[i].bps > max_bps) {
+			continue;
+		}
+		//slower than the start rate, or back on it
+		if(baud_table[i].bps < start_bps || baud_table[i].rate == start) {
+			break;
+		}
+		int moved = move_to(dev, baud_table[i].rate, stop, parity, apply, arg);
+		if(moved == -1) {
+			continue;
+		}
+		if(moved == 0 && test_rate(dev) == 0) {
+			return baud_table[i].rate;
+		}
+		//the failed rate is stored in the module, find it and store start again
+		if(BT_autobaud(dev, BT_BAUD_PROBE_TIMEOUT) == -1
+				|| move_to(dev, start, stop, parity, apply, arg) != 0
+				|| test_rate(dev) != 0) {
+			return -1;
+		}
+	}
+	return start;
+}
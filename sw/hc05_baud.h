@@ -0,0 +1,47 @@
+#ifndef HC_05_BAUD_H_
+#define HC_05_BAUD_H_
+
+#include <stdint.h>
+#include "hc05.h"
+
+/*
+ * Baud rate detection and negotiation with the HC05 module, in AT mode.
+ *
+ * BT_autobaud sweeps the rates of baud_rates.h with an "AT" probe until the
+ * module answers "OK". BT_negotiate_baud then asks the module for faster
+ * rates (AT+UART), fastest first, and keeps the first one where a series of
+ * probes gets through without error.
+ * BT_set_baud and BT_get_baud convert between any baud rate and
+ * UART_wait_cycles for a given clock, without the baud_rates.h values.
+ * Waits use BT_DELAY_US (usleep on the Nios), timeouts are in microseconds.
+ */
+
+#define BT_BAUD_PROBE_TIMEOUT 50000 /* us, answer to "AT" */
+#define BT_BAUD_TEST_PROBES 8       /* probes in a row for a rate to pass */
+#define BT_BAUD_MIN_CYCLES 2        /* smallest UART_wait_cycles, the receiver
+                                       samples at wait_cycles/2 */
+#define BT_BAUD_MIN_CYCLES_OVERSAMPLE 15 /* 16 ticks per bit at most one per
+                                            cycle, with BLT_RX_OVERSAMPLE */
+
+/* called by BT_negotiate_baud once the module accepted AT+UART, to make it
+ * use the new rate (AT+RESET, KEY pin...). Returns 0 if done, -1 otherwise. */
+typedef int (*hc05_baud_apply)(hc05_dev *dev, void *arg);
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+uint32_t BT_baud_bps(baud_rate rate);
+
+uint32_t BT_set_baud(hc05_dev *dev, uint32_t clk_hz, uint32_t bps, int32_t *error);
+
+uint32_t BT_get_baud(hc05_dev *dev, uint32_t clk_hz);
+
+int BT_at_probe(hc05_dev *dev, uint32_t timeout_us);
+
+int BT_autobaud(hc05_dev *dev, uint32_t timeout_us);
+
+int BT_negotiate_baud(hc05_dev *dev, baud_rate max, hc05_baud_apply apply,
+		void *arg);
+
+#endif /* HC_05_BAUD_H_ */
@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "hc05_bench.h"
+#include "hc05_baud.h"
+#define BT_USE_CYCLES
+#define BT_USE_DELAY_US
+#include "hc05_time.h"
+
+/* APIs under test */
+typedef enum {
+	TX_WORD, TX_MESSAGE, TX_SENDV, TX_DMA,
+	RX_WORD, RX_READ, RX_DMA
+} bench_api;
+
+static const char *api_names[] = {
+	"send_word_safe", "send_message", "sendv", "send_dma",
+	"get_data_safe", "read", "recv_dma"
+};
+
+/* result of one test */
+typedef struct {
+	uint32_t bytes;     /* bytes through */
+	uint32_t lost;      /* bytes that did not come back */
+	uint64_t cycles;    /* from the first call to the last byte */
+	uint64_t cpu;       /* in the calls of the API under test */
+	uint32_t *lat;      /* round trip times in us, "echo" only */
+	uint32_t count;
+} bench_result;
+
+/* sweep of BT_bench_run */
+static const baud_rate rates[] = {
+	b4800, b9600, b19200, b38400, b57600, b115200, b230400, b460800,
+	b921600, b1382400
+};
+static const struct {
+	uint32_t ctrl;
+	const char *name;
+} parities[] = {
+	{BLT_NO_PARITY, "none"}, {BLT_EVEN_PARITY, "even"}, {BLT_ODD_PARITY, "odd"}
+};
+static const uint32_t stops[] = {BLT_STOP_0, BLT_STOP_1};
+
+/* bits on the line per byte */
+static uint32_t frame_bits(uint32_t ctrl) {
+	uint32_t bits = 1 + 8 + 1;
+	if(ctrl & BLT_EVEN_PARITY) {
+		++bits;
+	}
+	if((ctrl & BLT_STOP_MASK) == BLT_STOP_1) {
+		++bits;
+	}
+	return bits;
+}
+
+static uint64_t cycles_us(hc05_dev *dev, uint64_t cycles) {
+	return cycles * 1000000 / BT_CYCLES_HZ(dev);
+}
+
+/* one call of a TX API, returns the bytes accepted (0 if refused) */
+static uint32_t tx_call(hc05_bench *bench, bench_api api, uint32_t sent) {
+	hc05_dev *dev = bench->dev;
+	char *data = bench->tx + sent;
+	uint32_t length = bench->bytes - sent;
+	if(length > BT_BENCH_CHUNK) {
+		length = BT_BENCH_CHUNK;
+	}
+	switch(api) {
+	case TX_WORD:
+		return BT_send_word_safe(dev, data[0]) == -1 ? 0 : 1;
+	case TX_MESSAGE:
+		return BT_send_message(dev, data, length) == -1 ? 0 : length;
+	case TX_SENDV: {
+		//header and payload, as a frame would be sent
+		bt_iov iov[2] = {{data, length / 8}, {data + length / 8, length - length / 8}};
+		return BT_sendv(dev, iov, 2) == -1 ? 0 : length;
+	}
+	default:
+		return BT_send_dma(dev, data, bench->bytes - sent) == -1 ? 0
+			: bench->bytes - sent;
+	}
+}
+
+/* one call of a RX API, returns the bytes read */
+static uint32_t rx_call(hc05_bench *bench, bench_api api, uint32_t got) {
+	hc05_dev *dev = bench->dev;
+	int n;
+	switch(api) {
+	case RX_WORD:
+		return BT_get_data_safe(dev, bench->rx + got) == -1 ? 0 : 1;
+	case RX_READ:
+		n = BT_read(dev, bench->rx + got, bench->bytes - got);
+		return n < 0 ? 0 : n;
+	default:
+		//the channel started by run_rx fills the whole buffer
+		return bench->bytes - BT_dma_rx_left(dev) - got;
+	}
+}
+
+static void run_tx(hc05_bench *bench, bench_api api, uint32_t poll_us,
+		bench_result *res) {
+	hc05_dev *dev = bench->dev;
+	hc05_stats stats;
+	uint32_t sent = 0;
+	BT_get_stats(dev, &stats);
+	uint32_t tx0 = stats.tx_bytes;
+	uint64_t start = BT_CYCLES(dev);
+	while(sent < bench->bytes) {
+		uint64_t call = BT_CYCLES(dev);
+		uint32_t n = tx_call(bench, api, sent);
+		res->cpu += BT_CYCLES(dev) - call;
+		if(n == 0) {
+			BT_DELAY_US(dev, poll_us);
+		}
+		sent += n;
+	}
+	//the last frame is out one frame time after it started
+	do {
+		BT_DELAY_US(dev, poll_us / BT_BENCH_POLL_FRAMES);
+		BT_get_stats(dev, &stats);
+	} while(stats.tx_bytes - tx0 < bench->bytes);
+	BT_DELAY_US(dev, poll_us / BT_BENCH_POLL_FRAMES);
+	res->cycles = BT_CYCLES(dev) - start;
+	res->bytes = bench->bytes;
+}
+
+static void run_rx(hc05_bench *bench, bench_api api, uint32_t poll_us,
+		uint64_t timeout_us, bench_result *res) {
+	hc05_dev *dev = bench->dev;
+	uint32_t fed = 0;
+	uint32_t got = 0;
+	uint64_t start = BT_CYCLES(dev);
+	uint64_t last = start;
+	if(api == RX_DMA) {
+		BT_recv_dma(dev, bench->rx, bench->bytes);
+		res->cpu += BT_CYCLES(dev) - start;
+	}
+	while(got < bench->bytes && cycles_us(dev, BT_CYCLES(dev) - last) < timeout_us) {
+		if(fed < bench->bytes) {
+			uint32_t length = bench->bytes - fed;
+			if(length > BT_BENCH_CHUNK) {
+				length = BT_BENCH_CHUNK;
+			}
+			if(BT_send_message(dev, bench->tx + fed, length) != -1) {
+				fed += length;
+			}
+		}
+		uint64_t call = BT_CYCLES(dev);
+		uint32_t n = rx_call(bench, api, got);
+		res->cpu += BT_CYCLES(dev) - call;
+		if(n != 0) {
+			got += n;
+			last = BT_CYCLES(dev);
+		} else {
+			//nothing yet : the next byte is at most a frame time away
+			BT_DELAY_US(dev, fed == bench->bytes ? poll_us
+				: poll_us / BT_BENCH_POLL_FRAMES);
+		}
+	}
+	res->cycles = last - start;
+	res->bytes = got;
+	res->lost = bench->bytes - got;
+	if(api == RX_DMA && BT_dma_rx_left(dev) != 0) {
+		BT_dma_abort(dev, BLT_I_PENDING_DMA_RX);
+	}
+}
+
+static int cmp_u32(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+	return x < y ? -1 : x > y;
+}
+
+static void run_echo(hc05_bench *bench, uint32_t poll_us, uint64_t timeout_us,
+		uint32_t *lat, bench_result *res) {
+	hc05_dev *dev = bench->dev;
+	uint32_t samples = bench->samples;
+	if(samples > BT_BENCH_MAX_SAMPLES) {
+		samples = BT_BENCH_MAX_SAMPLES;
+	}
+	for(uint32_t s = 0; s < samples; ++s) {
+		uint32_t got = 0;
+		uint64_t start = BT_CYCLES(dev);
+		while(BT_send_message(dev, bench->tx, BT_BENCH_ECHO_LENGTH) == -1);
+		res->cpu += BT_CYCLES(dev) - start;
+		uint64_t now = BT_CYCLES(dev);
+		while(got < BT_BENCH_ECHO_LENGTH && cycles_us(dev, now - start) < timeout_us) {
+			int n = BT_read(dev, bench->rx + got, BT_BENCH_ECHO_LENGTH - got);
+			uint64_t after = BT_CYCLES(dev);
+			res->cpu += after - now;
+			if(n > 0) {
+				got += n;
+				now = after;
+			} else {
+				BT_DELAY_US(dev, poll_us);
+				now = BT_CYCLES(dev);
+			}
+		}
+		res->bytes += got;
+		res->lost += BT_BENCH_ECHO_LENGTH - got;
+		res->cycles += now - start;
+		lat[res->count++] = cycles_us(dev, now - start);
+		//start the next round trip at another point of the bit times
+		BT_DELAY_US(dev, poll_us * (s % 7));
+	}
+	qsort(lat, res->count, sizeof(lat[0]), cmp_u32);
+	res->lat = lat;
+}
+
+static void print_row(hc05_bench *bench, FILE *out, uint32_t bps,
+		uint32_t line_bps, uint32_t ctrl, const char *test, const char *api,
+		const bench_result *res) {
+	uint32_t p = 0;
+	while(p < sizeof(parities) / sizeof(parities[0])
+			&& parities[p].ctrl != (ctrl & BLT_PARTITY_MASK)) {
+		++p;
+	}
+	uint64_t rate = res->cycles != 0
+		? (uint64_t) res->bytes * BT_CYCLES_HZ(bench->dev) / res->cycles : 0;
+	fprintf(out, "%" PRIu32 ",%s,%u,%s,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%.1f,%.1f",
+		bps, parities[p].name, (ctrl & BLT_STOP_MASK) == BLT_STOP_1 ? 2 : 1,
+		test, api, res->bytes, res->lost, rate,
+		100.0 * rate * frame_bits(ctrl) / line_bps,
+		res->bytes != 0 ? (double) res->cpu / res->bytes : 0.0);
+	if(res->lat != NULL && res->count != 0) {
+		const uint32_t *lat = res->lat;
+		uint32_t n = res->count;
+		fprintf(out, ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+			lat[(n - 1) * 50 / 100], lat[(n - 1) * 90 / 100],
+			lat[(n - 1) * 99 / 100], lat[n - 1]);
+	} else {
+		fprintf(out, ",,,,\n");
+	}
+}
+
+/*
+ * Initialize a benchmark. tx is filled with a pattern, both buffers must stay
+ * valid while it runs and be reachable by the DMA channels.
+ * name: BT_bench_init
+ * @param bench : The benchmark,
+ *        dev   : The HC05 device struct, in data mode with an echoing remote,
+ *        tx    : bytes to send, bytes long,
+ *        rx    : bytes received, bytes long,
+ *        bytes : the size of each throughput test, a few FIFO depths for a
+ *                sustained rate.
+ * @return void
+ *
+ * example: static char tx[4096], rx[4096];
+ * hc05_bench bench;
+ * BT_bench_init(&bench, &dev, tx, rx, sizeof(tx));
+ */
+void BT_bench_init(hc05_bench *bench, hc05_dev *dev, char *tx, char *rx,
+		uint32_t bytes) {
+	memset(bench, 0, sizeof(*bench));
+	bench->dev = dev;
+	bench->tx = tx;
+	bench->rx = rx;
+	bench->bytes = bytes;
+	bench->samples = 100;
+	for(uint32_t i = 0; i < bytes; ++i) {
+		tx[i] = 'a' + i % 26;
+	}
+}
+
+/*
+ * Print the CSV header of BT_bench_config lines.
+ * name: BT_bench_header
+ * @param out : where to print.
+ * @return void
+ *
+ * example: BT_bench_header(stdout);
+ * //baud,parity,stop_bits,test,api,bytes,lost,bytes_per_s,line_pct,
+ * //cycles_per_byte,p50_us,p90_us,p99_us,max_us
+ */
+void BT_bench_header(FILE *out) {
+	fprintf(out, "baud,parity,stop_bits,test,api,bytes,lost,bytes_per_s,line_pct,"
+		"cycles_per_byte,p50_us,p90_us,p99_us,max_us\n");
+}
+
+/*
+ * Run the tests of one configuration and print a CSV line for each :
+ *  - bytes_per_s     : sustained rate,
+ *  - line_pct        : share of the line used, at the rate of BT_get_baud,
+ *  - cycles_per_byte : time spent in the calls of the API under test,
+ *  - p50_us .. max_us : round trip percentiles, "echo" only.
+ * name: BT_bench_config
+ * @param bench : The benchmark,
+ *        out   : where to print,
+ *        rate  : the baud_rate,
+ *        ctrl  : parity and stop bits, as in CTRL.
+ * @return 0, -1 if bench->apply failed (nothing is printed).
+ *
+ * example: BT_bench_config(&bench, stdout, b921600, BLT_NO_PARITY | BLT_STOP_0);
+ */
+int BT_bench_config(hc05_bench *bench, FILE *out, baud_rate rate, uint32_t ctrl) {
+	static uint32_t lat[BT_BENCH_MAX_SAMPLES];
+	hc05_dev *dev = bench->dev;
+	uint32_t bps = BT_baud_bps(rate);
+	uint32_t frame_us = frame_bits(ctrl) * 1000000 / bps + 1;
+	uint32_t poll_us = BT_BENCH_POLL_FRAMES * frame_us;
+	//a lost byte stops the rx tests after this much silence
+	uint64_t timeout_us = 4 * (uint64_t) BT_get_fifo_in_depth(dev) * frame_us + 100000;
+	if(bench->apply != NULL && bench->apply(dev, bench->arg, rate, ctrl) != 0) {
+		return -1;
+	}
+	BT_set_CTRL(dev, (BT_get_CTRL(dev) & ~(BLT_PARTITY_MASK | BLT_STOP_MASK))
+		| BLT_UART_ON | ctrl);
+	BT_set_baud_rate(dev, rate);
+	uint32_t line_bps = BT_get_baud(dev, BT_CLK_HZ);
+
+	for(bench_api api = TX_WORD; api <= RX_DMA; ++api) {
+		bench_result res;
+		memset(&res, 0, sizeof(res));
+		if((api == TX_DMA || api == RX_DMA) && !(BT_get_caps(dev) & BLT_CAPS_DMA)) {
+			continue;
+		}
+		BT_reset_FIFO(dev, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
+		if(api <= TX_DMA) {
+			run_tx(bench, api, poll_us, &res);
+		} else {
+			run_rx(bench, api, poll_us, timeout_us, &res);
+		}
+		print_row(bench, out, bps, line_bps, ctrl, api <= TX_DMA ? "tx" : "rx",
+			api_names[api], &res);
+		//the echo of the tx tests, or what is left of a failed rx test
+		BT_DELAY_US(dev, timeout_us / 4);
+	}
+
+	bench_result res;
+	memset(&res, 0, sizeof(res));
+	BT_reset_FIFO(dev, BLT_RESET_FIFO_IN | BLT_RESET_FIFO_OUT);
+	run_echo(bench, frame_us / 4 + 1, timeout_us, lat, &res);
+	print_row(bench, out, bps, line_bps, ctrl, "echo", "send_message+read", &res);
+	return 0;
+}
+
+/*
+ * Run BT_bench_config for every baud_rate value, parity and stop bits, with
+ * the CSV header first.
+ * name: BT_bench_run
+ * @param bench : The benchmark,
+ *        out   : where to print.
+ * @return the amount of configurations skipped because bench->apply failed.
+ *
+ * example: hc05_bench bench;
+ * BT_bench_init(&bench, &dev, tx, rx, sizeof(tx));
+ * bench.apply = module_to;   //AT+UART, AT+RESET
+ * BT_bench_run(&bench, stdout);
+ */
+int BT_bench_run(hc05_bench *bench, FILE *out) {
+	int skipped = 0;
+	BT_bench_header(out);
+	for(uint32_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r) {
+		for(uint32_t p = 0; p < sizeof(parities) / sizeof(parities[0]); ++p) {
+			for(uint32_t s = 0; s < sizeof(stops) / sizeof(stops[0]); ++s) {
+				if(BT_bench_config(bench, out, rates[r], parities[p].ctrl | stops[s]) != 0) {
+					++skipped;
+				}
+			}
+		}
+	}
+	return skipped;
+}
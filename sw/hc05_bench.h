@@ -0,0 +1,65 @@
+#ifndef HC_05_BENCH_H_
+#define HC_05_BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include "hc05.h"
+
+/*
+ * Benchmark of the link and of the driver APIs, against a remote side that
+ * echoes every byte it receives (a PC echoing the SPP port, or the host model
+ * in loopback).
+ *
+ * For each baud_rate value, BLT_NO/EVEN/ODD_PARITY and BLT_STOP_0/1, it runs :
+ *  - "tx" : bytes sent through BT_send_word_safe, BT_send_message, BT_sendv
+ *    and BT_send_dma, polling again a frame time later when refused,
+ *  - "rx" : the echo of a stream read with BT_get_data_safe, BT_read and
+ *    BT_recv_dma, the stream being fed with BT_send_message,
+ *  - "echo" : round trips of BT_BENCH_ECHO_LENGTH bytes, sent with
+ *    BT_send_message and read back with BT_read.
+ * Each gives one CSV line (see BT_bench_run) : sustained throughput, line
+ * utilisation, cycles spent in the API under test per byte and, for "echo",
+ * latency percentiles. Cycles and times come from BT_CYCLES : the HAL
+ * timestamp on the Nios (alt_timestamp_start() first), the clock of the model
+ * on the host, where only the bus accesses take time.
+ * The percentiles are only meaningful on hardware, where the remote side and
+ * the radio link spread the round trips : the model echoes every byte after
+ * the same time, all of them come out equal.
+ */
+
+#define BT_BENCH_CHUNK 64          /* bytes per BT_send_message / BT_sendv */
+#define BT_BENCH_ECHO_LENGTH 8     /* bytes per round trip */
+#define BT_BENCH_MAX_SAMPLES 256   /* round trips per configuration */
+#define BT_BENCH_POLL_FRAMES 16    /* frame times between refused calls */
+
+/* called before each configuration, to move the module to it (AT+UART,
+ * AT+RESET...) ; the extension is switched after. Returns 0 if done, -1 to
+ * skip the configuration. */
+typedef int (*hc05_bench_apply)(hc05_dev *dev, void *arg, baud_rate rate,
+		uint32_t ctrl);
+
+/* benchmark structure */
+typedef struct {
+    hc05_dev *dev;
+    char *tx;                   /* Storage given by the user, bytes long */
+    char *rx;                   /* Storage given by the user, bytes long */
+    uint32_t bytes;             /* Bytes per throughput test */
+    uint32_t samples;           /* Round trips per "echo" test */
+    hc05_bench_apply apply;     /* NULL if the module follows by itself */
+    void *arg;                  /* First argument of apply */
+} hc05_bench;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+void BT_bench_init(hc05_bench *bench, hc05_dev *dev, char *tx, char *rx,
+		uint32_t bytes);
+
+void BT_bench_header(FILE *out);
+
+int BT_bench_config(hc05_bench *bench, FILE *out, baud_rate rate, uint32_t ctrl);
+
+int BT_bench_run(hc05_bench *bench, FILE *out);
+
+#endif /* HC_05_BENCH_H_ */
@@ -0,0 +1,98 @@
+#include <inttypes.h>
+
+#include "hc05_crc.h"
+
+static uint16_t crc16_table[4][256];
+static uint32_t crc32_table[8][256];
+static int crc16_ready;
+static int crc32_ready;
+
+static void crc16_init(void) {
+	for(uint32_t i = 0; i < 256; ++i) {
+		uint16_t crc = i << 8;
+		for(uint32_t b = 0; b < 8; ++b) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+		crc16_table[0][i] = crc;
+	}
+	for(uint32_t i = 0; i < 256; ++i) {
+		for(uint32_t k = 1; k < 4; ++k) {
+			uint16_t prev = crc16_table[k - 1][i];
+			crc16_table[k][i] = (prev << 8) ^ crc16_table[0][prev >> 8];
+		}
+	}
+	crc16_ready = 1;
+}
+
+static void crc32_init(void) {
+	for(uint32_t i = 0; i < 256; ++i) {
+		uint32_t crc = i;
+		for(uint32_t b = 0; b < 8; ++b) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+		}
+		crc32_table[0][i] = crc;
+	}
+	for(uint32_t i = 0; i < 256; ++i) {
+		for(uint32_t k = 1; k < 8; ++k) {
+			uint32_t prev = crc32_table[k - 1][i];
+			crc32_table[k][i] = (prev >> 8) ^ crc32_table[0][prev & 0xff];
+		}
+	}
+	crc32_ready = 1;
+}
+
+/*
+ * Update a CRC-16/CCITT (poly 0x1021, no reflection) with some bytes,
+ * 4 bytes per step.
+ * name: BT_crc16
+ * @param crc    : the CRC so far, 0xFFFF to start,
+ *        data   : the bytes,
+ *        length : the amount of bytes.
+ * @return the updated CRC.
+ *
+ * example: uint16_t crc = BT_crc16(0xFFFF, "123456789", 9); //crc = 0x29B1
+ */
+uint16_t BT_crc16(uint16_t crc, const void *data, uint32_t length) {
+	const uint8_t *p = (const uint8_t *) data;
+	if(!crc16_ready) {
+		crc16_init();
+	}
+	for(; length >= 4; length -= 4, p += 4) {
+		crc = crc16_table[3][p[0] ^ (crc >> 8)] ^ crc16_table[2][p[1] ^ (crc & 0xff)]
+			^ crc16_table[1][p[2]] ^ crc16_table[0][p[3]];
+	}
+	for(; length != 0; --length, ++p) {
+		crc = (crc << 8) ^ crc16_table[0][*p ^ (crc >> 8)];
+	}
+	return crc;
+}
+
+/*
+ * Update a CRC-32 (IEEE 802.3) with some bytes, 8 bytes per step.
+ * name: BT_crc32
+ * @param crc    : the CRC so far, 0 to start,
+ *        data   : the bytes,
+ *        length : the amount of bytes.
+ * @return the updated CRC.
+ *
+ * example: uint32_t crc = BT_crc32(0, "123456789", 9); //crc = 0xCBF43926
+ */
+uint32_t BT_crc32(uint32_t crc, const void *data, uint32_t length) {
+	const uint8_t *p = (const uint8_t *) data;
+	if(!crc32_ready) {
+		crc32_init();
+	}
+	crc = ~crc;
+	for(; length >= 8; length -= 8, p += 8) {
+		uint32_t one = (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)) ^ crc;
+		uint32_t two = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+		crc = crc32_table[7][one & 0xff] ^ crc32_table[6][(one >> 8) & 0xff]
+			^ crc32_table[5][(one >> 16) & 0xff] ^ crc32_table[4][one >> 24]
+			^ crc32_table[3][two & 0xff] ^ crc32_table[2][(two >> 8) & 0xff]
+			^ crc32_table[1][(two >> 16) & 0xff] ^ crc32_table[0][two >> 24];
+	}
+	for(; length != 0; --length, ++p) {
+		crc = (crc >> 8) ^ crc32_table[0][(crc ^ *p) & 0xff];
+	}
+	return ~crc;
+}
@@ -0,0 +1,22 @@
+#ifndef HC_05_CRC_H_
+#define HC_05_CRC_H_
+
+#include <stdint.h>
+
+/*
+ * Table driven CRCs for the HC05 frames.
+ *  - CRC-16/CCITT (poly 0x1021, MSB first), slice-by-4 : 2 KB of tables.
+ *  - CRC-32 (IEEE 802.3, poly 0xEDB88320 reflected), slice-by-8 : 8 KB of
+ *    tables, zlib convention (start with 0, chainable).
+ * The tables are computed on the first call.
+ */
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+uint16_t BT_crc16(uint16_t crc, const void *data, uint32_t length);
+
+uint32_t BT_crc32(uint32_t crc, const void *data, uint32_t length);
+
+#endif /* HC_05_CRC_H_ */
@@ -0,0 +1,271 @@
+#include <string.h>
+#include <inttypes.h>
+
+#include "hc05_frame.h"
+#include "hc05_crc.h"
+
+/*
+ * Initialize a framed link on a HC05 device.
+ * name: BT_link_init
+ * @param link : The link struct,
+ *        dev  : The HC05 device struct.
+ * @return void
+ *
+ * example: bt_link link; BT_link_init(&link, &dev);
+ */
+void BT_link_init(bt_link *link, hc05_dev *dev) {
+	memset(link, 0, sizeof(*link));
+	link->dev = dev;
+	link->state = BT_FRAME_HUNT;
+}
+
+/*
+ * Let the CRC unit of the extension compute the frame CRCs, when the link goes
+ * straight to the FIFOs (no transmit queue, no receive ring : BT_isr and
+ * BT_tx_refill move bytes behind the back of the accumulators).
+ * name: BT_link_hw_crc
+ * @param link : The link struct,
+ *        on   : 1 to use the CRC unit, 0 to compute the CRCs in software.
+ * @return 0, -1 if the extension was built without CRC unit.
+ *
+ * example: BT_link_hw_crc(&link, 1);
+ */
+int BT_link_hw_crc(bt_link *link, int on) {
+	if(on && !(BT_get_caps(link->dev) & BLT_CAPS_CRC)) {
+		return -1;
+	}
+	link->hw_crc = on ? 1 : 0;
+	return 0;
+}
+
+/* check byte of a header : low byte of the CRC of length and sequence */
+static uint8_t header_check(const uint8_t *head) {
+	return BT_crc16(0xFFFF, head + 1, BT_FRAME_HEADER - 2) & 0xff;
+}
+
+/*
+ * Send a frame through the FIFO_out, the CRC unit following the bytes after
+ * SYNC. Same return values as BT_frame_send.
+ */
+static int frame_send_hw_crc(bt_link *link, const uint8_t *head,
+		const char *payload, uint32_t length) {
+	hc05_dev *dev = link->dev;
+	uint32_t total = BT_FRAME_HEADER + length + BT_FRAME_TRAILER;
+	uint32_t space = BT_get_free_space(dev);
+	if(space < total) {
+		return -1;
+	}
+	BT_send_word(dev, head[0]);
+	BT_set_crc_out(dev, 0xFFFF);
+	BT_write_FIFO_out(dev, (const char *) head + 1, BT_FRAME_HEADER - 1);
+	BT_write_FIFO_out(dev, payload, length);
+	uint16_t crc = BT_get_crc_out(dev);
+	BT_send_word(dev, crc & 0xff);
+	BT_send_word(dev, crc >> 8);
+	return space - total;
+}
+
+/*
+ * Send a payload in a frame. Goes through the transmit queue if one was given
+ * with BT_tx_ring_init, straight to the output FIFO otherwise.
+ * name: BT_frame_send
+ * @param link    : The link struct,
+ *        payload : the payload,
+ *        length  : the length of the payload, at most BT_FRAME_MAX_PAYLOAD.
+ * @return the free space after the send
+ *          or -1 if the frame couldn't be sent (nothing is sent).
+ *
+ * example: char cmd[4] = {'C', r, g, b};
+ * BT_frame_send(&link, cmd, 4);
+ */
+int BT_frame_send(bt_link *link, const char *payload, uint32_t length) {
+	uint8_t head[BT_FRAME_HEADER];
+	uint8_t trailer[BT_FRAME_TRAILER];
+	if(length > BT_FRAME_MAX_PAYLOAD) {
+		return -1;
+	}
+	head[0] = BT_FRAME_SYNC;
+	head[1] = length & 0xff;
+	head[2] = length >> 8;
+	head[3] = link->tx_seq;
+	head[4] = header_check(head);
+	if(link->hw_crc && link->dev->tx.size == 0) {
+		int ret = frame_send_hw_crc(link, head, payload, length);
+		if(ret != -1) {
+			++link->tx_seq;
+		}
+		return ret;
+	}
+	uint16_t crc = BT_crc16(0xFFFF, head + 1, BT_FRAME_HEADER - 1);
+	crc = BT_crc16(crc, payload, length);
+	trailer[0] = crc & 0xff;
+	trailer[1] = crc >> 8;
+
+	bt_iov iov[3] = {
+		{(const char *) head, BT_FRAME_HEADER},
+		{payload, length},
+		{(const char *) trailer, BT_FRAME_TRAILER}
+	};
+	int ret;
+	if(link->dev->tx.size != 0) {
+		ret = BT_tx_enqueuev(link->dev, iov, 3);
+	} else {
+		ret = BT_sendv(link->dev, iov, 3);
+	}
+	if(ret != -1) {
+		++link->tx_seq;
+	}
+	return ret;
+}
+
+/* Received bytes come from the ring buffer if BT_isr fills one */
+static uint32_t link_available(bt_link *link) {
+	if(link->dev->rx.size != 0) {
+		return BT_rx_available(link->dev);
+	}
+	return BT_get_pending_data(link->dev);
+}
+
+static void link_read(bt_link *link, void *data, uint32_t length) {
+	if(link->dev->rx.size != 0) {
+		BT_rx_read(link->dev, (char *) data, length);
+	} else {
+		BT_read_FIFO_in(link->dev, (char *) data, length);
+	}
+}
+
+/* sequence number of a sound header, the gap since the last one is lost */
+static void sequence(bt_link *link) {
+	uint8_t seq = link->head[3];
+	if(link->rx_synced && seq != link->rx_seq) {
+		link->lost += (uint8_t)(seq - link->rx_seq);
+	}
+	link->rx_seq = seq + 1;
+	link->rx_synced = 1;
+}
+
+/*
+ * The header read is not one : go on hunting from the byte after its SYNC,
+ * the bytes after it already read are looked at first.
+ */
+static void header_resync(bt_link *link) {
+	uint32_t i = 1;
+	while(i < link->head_len && link->head[i] != BT_FRAME_SYNC) {
+		++i;
+	}
+	if(i == link->head_len) {
+		link->state = BT_FRAME_HUNT;
+		return;
+	}
+	link->head_len -= i;
+	memmove(link->head, link->head + i, link->head_len);
+	if(link->hw_crc && link->dev->rx.size == 0) {
+		//the CRC unit went on since the first SYNC, restart it from this one
+		BT_set_crc_in(link->dev, BT_crc16(0xFFFF, link->head + 1, link->head_len - 1));
+	}
+}
+
+/*
+ * Receive a frame, without blocking. The header is read and checked as soon
+ * as it is there, the payload and CRC once they are all received, in one read.
+ * name: BT_frame_recv
+ * @param link    : The link struct,
+ *        payload : a pointer to a char array that will contain the payload,
+ *        max     : the size of payload.
+ * @return the length of the payload received,
+ *          BT_FRAME_NONE if no complete frame is waiting yet,
+ *          BT_FRAME_CORRUPTED if a frame was thrown away (bad header, CRC or length),
+ *          or BT_FRAME_TOO_LONG if the next frame doesn't fit in max bytes : it
+ *          is skipped as its bytes arrive and doesn't count as corrupted.
+ *
+ * example: char msg[64]; int len;
+ * while((len = BT_frame_recv(&link, msg, 64)) == BT_FRAME_NONE) { do something else }
+ * link.lost tells how many frames were missed before this one.
+ */
+int BT_frame_recv(bt_link *link, char *payload, uint32_t max) {
+	uint32_t avail = link_available(link);
+	while(link->state != BT_FRAME_BODY) {
+		if(avail == 0) {
+			return BT_FRAME_NONE;
+		}
+		if(link->state == BT_FRAME_SKIP) {
+			char discard[32];
+			uint32_t n = link->skip < avail ? link->skip : avail;
+			if(n > sizeof(discard)) {
+				n = sizeof(discard);
+			}
+			link_read(link, discard, n);
+			avail -= n;
+			link->skip -= n;
+			if(link->skip == 0) {
+				link->state = BT_FRAME_HUNT;
+			}
+		} else if(link->state == BT_FRAME_HUNT) {
+			uint8_t c;
+			link_read(link, &c, 1);
+			--avail;
+			if(c == BT_FRAME_SYNC) {
+				if(link->hw_crc && link->dev->rx.size == 0) {
+					BT_set_crc_in(link->dev, 0xFFFF);
+				}
+				link->head[0] = c;
+				link->head_len = 1;
+				link->state = BT_FRAME_HEAD;
+			}
+		} else {
+			uint32_t n = BT_FRAME_HEADER - link->head_len;
+			if(n > avail) {
+				n = avail;
+			}
+			link_read(link, link->head + link->head_len, n);
+			avail -= n;
+			link->head_len += n;
+			if(link->head_len == BT_FRAME_HEADER) {
+				uint32_t length = link->head[1] | (link->head[2] << 8);
+				if(link->head[4] != header_check(link->head)
+						|| length > BT_FRAME_MAX_PAYLOAD) {
+					++link->corrupted;
+					header_resync(link);
+					return BT_FRAME_CORRUPTED;
+				}
+				if(length > max) {
+					//a sound frame, the buffer is too small : skip it
+					link->skip = length + BT_FRAME_TRAILER;
+					link->state = BT_FRAME_SKIP;
+					sequence(link);
+					return BT_FRAME_TOO_LONG;
+				}
+				link->state = BT_FRAME_BODY;
+			}
+		}
+	}
+
+	uint32_t length = link->head[1] | (link->head[2] << 8);
+	if(avail < length + BT_FRAME_TRAILER) {
+		return BT_FRAME_NONE;
+	}
+	uint8_t trailer[BT_FRAME_TRAILER];
+	uint16_t crc;
+	link_read(link, payload, length);
+	if(link->hw_crc && link->dev->rx.size == 0) {
+		crc = BT_get_crc_in(link->dev);
+	} else {
+		crc = BT_crc16(0xFFFF, link->head + 1, BT_FRAME_HEADER - 1);
+		crc = BT_crc16(crc, payload, length);
+	}
+	link_read(link, trailer, BT_FRAME_TRAILER);
+	link->state = BT_FRAME_HUNT;
+
+	if(link->dev->rx.size == 0
+			&& (BT_get_i_pending(link->dev) & BLT_I_PENDING_DROP)) {
+		BT_ack_i_pending(link->dev, BLT_I_PENDING_DROP);
+		++link->i_dropped;
+	}
+
+	if(crc != (trailer[0] | (trailer[1] << 8))) {
+		++link->corrupted;
+		return BT_FRAME_CORRUPTED;
+	}
+	sequence(link);
+	return length;
+}
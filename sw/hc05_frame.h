@@ -0,0 +1,69 @@
+#ifndef HC_05_FRAME_H_
+#define HC_05_FRAME_H_
+
+#include <stdint.h>
+#include "hc05.h"
+
+/*
+ * Framing layer on top of the HC05 driver.
+ *
+ * Frame format :
+ *   SYNC (0xA5) | length (2 bytes, LE) | sequence | check | payload | CRC-16 (2 bytes, LE)
+ * check is the low byte of the CRC-16/CCITT (poly 0x1021, init 0xFFFF) of
+ * length and sequence, the CRC-16 covers length, sequence, check and payload.
+ * The receiver checks the header as soon as it is there : a bad one is
+ * thrown away at once and the hunt for SYNC goes on from the byte after the
+ * SYNC, instead of waiting for a corrupted length worth of bytes. It then
+ * reads the whole payload and CRC with a single length-driven read. Sequence
+ * gaps count lost frames, bad headers, CRCs and lengths count corrupted ones.
+ * The CRCs come from hc05_crc.c, or from the CRC unit of the extension after
+ * BT_link_hw_crc.
+ */
+
+#define BT_FRAME_SYNC 0xA5
+#define BT_FRAME_HEADER 5
+#define BT_FRAME_TRAILER 2
+#define BT_FRAME_MAX_PAYLOAD 1000
+
+//BT_frame_recv RETURN DEFINES
+#define BT_FRAME_NONE -1
+#define BT_FRAME_CORRUPTED -2
+#define BT_FRAME_TOO_LONG -3
+
+/* receiver states */
+typedef enum {
+    BT_FRAME_HUNT,      /* Looking for SYNC */
+    BT_FRAME_HEAD,      /* Reading length, sequence and check */
+    BT_FRAME_BODY,      /* Waiting for payload and CRC */
+    BT_FRAME_SKIP       /* Discarding a frame longer than the buffer */
+} bt_frame_state;
+
+/* framed link structure */
+typedef struct {
+    hc05_dev *dev;          /* Device carrying the frames */
+    uint8_t tx_seq;         /* Sequence number of the next frame sent */
+    uint8_t rx_seq;         /* Sequence number expected */
+    uint8_t rx_synced;      /* A valid frame was received, rx_seq is known */
+    bt_frame_state state;
+    uint8_t head[BT_FRAME_HEADER];
+    uint32_t head_len;
+    uint32_t skip;          /* Bytes left to discard in BT_FRAME_SKIP */
+    uint32_t lost;          /* Frames missing from the sequence */
+    uint32_t corrupted;     /* Frames with a bad header, CRC or length */
+    uint32_t i_dropped;     /* i_dropped seen, bytes lost in FIFO_in */
+    uint8_t hw_crc;         /* CRCs from the CRC unit, see BT_link_hw_crc */
+} bt_link;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+void BT_link_init(bt_link *link, hc05_dev *dev);
+
+int BT_link_hw_crc(bt_link *link, int on);
+
+int BT_frame_send(bt_link *link, const char *payload, uint32_t length);
+
+int BT_frame_recv(bt_link *link, char *payload, uint32_t max);
+
+#endif /* HC_05_FRAME_H_ */
@@ -0,0 +1,251 @@
+#include <string.h>
+
+#include "hc05_multi.h"
+#define BT_USE_TIME_US
+#include "hc05_time.h"
+
+/* wait between two rounds, the host models advance their clocks instead */
+#ifndef BT_MULTI_DELAY_US
+#include <unistd.h>
+#define BT_MULTI_DELAY_US(SET, US) usleep(US)
+#endif
+
+static int find(hc05_multi *set, hc05_dev *dev) {
+	for(uint32_t i = 0; i < set->count; ++i) {
+		if(set->entry[i].dev == dev) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* the device holds its irq line : a pending interrupt is enabled */
+static int irq_raised(hc05_dev *dev) {
+	uint32_t i_pending = BT_get_i_pending(dev) & BLT_I_PENDING_MASK;
+	if(i_pending == 0) {
+		return 0;
+	}
+	uint32_t ctrl = BT_get_CTRL(dev);
+	//CTRL bits 2..1 enable i_pending bits 1..0, bits 9..6 bits 5..2
+	uint32_t i_enable = (ctrl & (BLT_I_ENABLE_RCV | BLT_I_ENABLE_DROP)) >> 1;
+	i_enable |= (ctrl & (BLT_I_ENABLE_TX_LOW | BLT_I_ENABLE_DMA_TX
+		| BLT_I_ENABLE_DMA_RX | BLT_I_ENABLE_RX_IDLE)) >> 4;
+	return (i_pending & i_enable) != 0;
+}
+
+/*
+ * Initialize an empty set of devices.
+ * name: BT_multi_init
+ * @param set : The set struct.
+ * @return void
+ *
+ * example: hc05_multi set; BT_multi_init(&set);
+ */
+void BT_multi_init(hc05_multi *set) {
+	memset(set, 0, sizeof(*set));
+	set->poll_us = BT_MULTI_POLL_US;
+}
+
+/*
+ * Add a device to the set.
+ * name: BT_multi_add
+ * @param set      : The set struct,
+ *        dev      : The HC05 device struct,
+ *        events   : the events to watch, BT_MULTI_RX and/or BT_MULTI_TX,
+ *        tx_space : the bytes that must fit for BT_MULTI_TX (1 if 0),
+ *        arg      : returned with the events of the device.
+ * @return the index of the device in the set
+ *          or -1 if the set is full or already holds the device.
+ *
+ * example: BT_multi_add(&set, &sensor[0], BT_MULTI_RX, 0, &link[0]);
+ */
+int BT_multi_add(hc05_multi *set, hc05_dev *dev, uint32_t events,
+		uint32_t tx_space, void *arg) {
+	if(set->count == BT_MULTI_MAX || find(set, dev) != -1) {
+		return -1;
+	}
+	hc05_multi_entry *entry = &set->entry[set->count];
+	entry->dev = dev;
+	entry->events = events & (BT_MULTI_RX | BT_MULTI_TX);
+	entry->tx_space = tx_space != 0 ? tx_space : 1;
+	entry->arg = arg;
+	return set->count++;
+}
+
+/*
+ * Change the events watched on a device of the set, e.g. BT_MULTI_TX only
+ * while there is something to send.
+ * name: BT_multi_watch
+ * @param set      : The set struct,
+ *        dev      : The HC05 device struct,
+ *        events   : the events to watch, 0 for none,
+ *        tx_space : the bytes that must fit for BT_MULTI_TX (1 if 0).
+ * @return 0 or -1 if the device is not in the set.
+ *
+ * example: BT_multi_watch(&set, &sensor[0], BT_MULTI_RX | BT_MULTI_TX, 64);
+ */
+int BT_multi_watch(hc05_multi *set, hc05_dev *dev, uint32_t events,
+		uint32_t tx_space) {
+	int i = find(set, dev);
+	if(i == -1) {
+		return -1;
+	}
+	set->entry[i].events = events & (BT_MULTI_RX | BT_MULTI_TX);
+	set->entry[i].tx_space = tx_space != 0 ? tx_space : 1;
+	return 0;
+}
+
+/*
+ * Remove a device from the set, the devices after it move down one index.
+ * Must not run concurrently with BT_multi_isr.
+ * name: BT_multi_remove
+ * @param set : The set struct,
+ *        dev : The HC05 device struct.
+ * @return 0 or -1 if the device is not in the set.
+ *
+ * example: BT_multi_remove(&set, &sensor[0]);
+ */
+int BT_multi_remove(hc05_multi *set, hc05_dev *dev) {
+	int i = find(set, dev);
+	if(i == -1) {
+		return -1;
+	}
+	--set->count;
+	memmove(&set->entry[i], &set->entry[i + 1],
+		(set->count - i) * sizeof(set->entry[0]));
+	if(set->next > (uint32_t) i) {
+		--set->next;
+	}
+	if(set->next >= set->count) {
+		set->next = 0;
+	}
+	return 0;
+}
+
+/*
+ * Returns the watched events ready on a device of the set. The receive ring
+ * and the transmit queue are looked at when the device has them, the FIFO
+ * registers otherwise.
+ * name: BT_multi_ready
+ * @param entry : The entry of the device.
+ * @return BT_MULTI_RX and/or BT_MULTI_TX, 0 if none is ready.
+ *
+ * example: if(BT_multi_ready(&set.entry[0]) & BT_MULTI_RX)
+ */
+uint32_t BT_multi_ready(hc05_multi_entry *entry) {
+	hc05_dev *dev = entry->dev;
+	uint32_t ready = 0;
+	if(entry->events & BT_MULTI_RX) {
+		if(dev->rx.size != 0 ? BT_rx_available(dev) != 0
+				: BT_get_pending_data(dev) != 0) {
+			ready |= BT_MULTI_RX;
+		}
+	}
+	if(entry->events & BT_MULTI_TX) {
+		uint32_t space = dev->tx.size != 0 ? dev->tx.size - BT_tx_pending(dev)
+			: BT_get_free_space(dev);
+		if(space >= entry->tx_space) {
+			ready |= BT_MULTI_TX;
+		}
+	}
+	return ready;
+}
+
+/*
+ * Look once at every device of the set, without waiting.
+ * name: BT_multi_poll
+ * @param set    : The set struct,
+ *        events : a pointer to an array that will contain the ready devices,
+ *        max    : the size of events.
+ * @return the amount of ready devices put in events.
+ *
+ * example: hc05_multi_event ev[4];
+ * uint32_t n = BT_multi_poll(&set, ev, 4);
+ * for(uint32_t i = 0; i < n; ++i) if(ev[i].events & BT_MULTI_RX) ...
+ *
+ * When more than max devices are ready, the next call starts with the first
+ * one left out.
+ */
+uint32_t BT_multi_poll(hc05_multi *set, hc05_multi_event *events, uint32_t max) {
+	uint32_t n = 0;
+	uint32_t start = set->next;
+	for(uint32_t k = 0; k < set->count && n < max; ++k) {
+		uint32_t i = (start + k) % set->count;
+		hc05_multi_entry *entry = &set->entry[i];
+		uint32_t ready = BT_multi_ready(entry);
+		if(ready == 0) {
+			continue;
+		}
+		//rotate past the first device served, or past the last one if the
+		//events are full so that the ones left out come first
+		if(n == 0 || n == max - 1) {
+			set->next = (i + 1) % set->count;
+		}
+		events[n].dev = entry->dev;
+		events[n].events = ready;
+		events[n].arg = entry->arg;
+		++n;
+	}
+	return n;
+}
+
+/*
+ * Wait until a device of the set is ready, looking at the set every poll_us.
+ * name: BT_multi_wait
+ * @param set        : The set struct,
+ *        events     : a pointer to an array that will contain the ready devices,
+ *        max        : the size of events,
+ *        timeout_us : the longest wait, in microseconds.
+ * @return the amount of ready devices put in events, 0 after the timeout.
+ *
+ * example: hc05_multi_event ev[BT_MULTI_MAX];
+ * uint32_t n = BT_multi_wait(&set, ev, BT_MULTI_MAX, 1000000);
+ */
+uint32_t BT_multi_wait(hc05_multi *set, hc05_multi_event *events, uint32_t max,
+		uint32_t timeout_us) {
+	uint32_t n = BT_multi_poll(set, events, max);
+	if(n != 0 || set->count == 0) {
+		return n;
+	}
+	hc05_dev *clock = set->entry[0].dev;
+	uint64_t start = BT_TIME_US(clock);
+	while(BT_TIME_US(clock) - start < timeout_us) {
+		BT_MULTI_DELAY_US(set, set->poll_us);
+		n = BT_multi_poll(set, events, max);
+		if(n != 0) {
+			return n;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Interrupt service routine of a set of HC05 components : runs BT_isr for
+ * each device holding its irq line.
+ * name: BT_multi_isr
+ * @param context : The set struct, as given to alt_ic_isr_register.
+ * @return void
+ *
+ * example: for(int i = 0; i < 2; ++i) {
+ *     BT_rx_ring_init(&sensor[i], rx_buf[i], 4096);
+ *     BT_multi_add(&set, &sensor[i], BT_MULTI_RX, 0, NULL);
+ * }
+ * alt_ic_isr_register(HC05_0_IRQ_INTERRUPT_CONTROLLER_ID, HC05_0_IRQ,
+ *                     BT_multi_isr, &set, NULL);
+ * alt_ic_isr_register(HC05_1_IRQ_INTERRUPT_CONTROLLER_ID, HC05_1_IRQ,
+ *                     BT_multi_isr, &set, NULL);
+ * BT_rx_irq_enable(&sensor[0]); BT_rx_irq_enable(&sensor[1]);
+ *
+ * Costs one STATUS read per device of the set on each interrupt, whichever
+ * device raised it, and a CTRL read for the devices with a bit pending.
+ */
+void BT_multi_isr(void *context) {
+	hc05_multi *set = (hc05_multi *) context;
+	for(uint32_t i = 0; i < set->count; ++i) {
+		hc05_dev *dev = set->entry[i].dev;
+		if(irq_raised(dev)) {
+			BT_isr(dev);
+			++set->isr_calls;
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef HC_05_MULTI_H_
+#define HC_05_MULTI_H_
+
+#include <stdint.h>
+#include "hc05.h"
+
+/*
+ * Several HC05 extensions served together, one link per extension.
+ *
+ * Devices are registered in a hc05_multi set with the events to watch :
+ *   BT_MULTI_RX : bytes to read,
+ *   BT_MULTI_TX : room for tx_space bytes.
+ * BT_multi_poll returns, in one round over the set, the devices having one of
+ * their events ready ; BT_multi_wait repeats the rounds until one is ready or
+ * the timeout ends, waiting poll_us between two rounds instead of spinning.
+ * A round starts one device after the first one returned by the previous
+ * round, or after the last one when events was full, so that a busy link
+ * can't starve the others.
+ *
+ * A device with a receive ring (BT_rx_ring_init) is readable when the ring
+ * holds bytes, one with a transmit queue (BT_tx_ring_init) writable when the
+ * queue has the room : no bus access. The others are checked on their
+ * FIFO_in_pending_data and FIFO_out_free_space registers.
+ *
+ * BT_multi_isr serves the interrupts of every device of the set : registered
+ * for each IRQ of the extensions with the set as context, or once if they
+ * share an IRQ line, it runs BT_isr for the devices with an interrupt pending.
+ */
+
+#define BT_MULTI_MAX 16         /* devices per set */
+#define BT_MULTI_POLL_US 100    /* default time between two rounds */
+
+//EVENT DEFINES
+#define BT_MULTI_RX 0b1
+#define BT_MULTI_TX 0b10
+
+/* device of a set */
+typedef struct {
+    hc05_dev *dev;
+    uint32_t events;    /* Events watched, BT_MULTI_RX and/or BT_MULTI_TX */
+    uint32_t tx_space;  /* Bytes that must fit for BT_MULTI_TX */
+    void *arg;          /* Left to the user, e.g. the bt_link of the device */
+} hc05_multi_entry;
+
+/* ready device, returned by BT_multi_poll and BT_multi_wait */
+typedef struct {
+    hc05_dev *dev;
+    uint32_t events;    /* Events ready, among the watched ones */
+    void *arg;          /* arg given to BT_multi_add */
+} hc05_multi_event;
+
+/* set of devices */
+typedef struct {
+    hc05_multi_entry entry[BT_MULTI_MAX];
+    uint32_t count;             /* Devices in the set */
+    uint32_t next;              /* First entry of the next round */
+    uint32_t poll_us;           /* Time between two rounds of BT_multi_wait */
+    volatile uint32_t isr_calls;/* BT_isr calls made by BT_multi_isr */
+} hc05_multi;
+
+/*******************************************************************************
+ *  Public API
+ ******************************************************************************/
+
+void BT_multi_init(hc05_multi *set);
+
+int BT_multi_add(hc05_multi *set, hc05_dev *dev, uint32_t events,
+		uint32_t tx_space, void *arg);
+
+int BT_multi_watch(hc05_multi *set, hc05_dev *dev, uint32_t events,
+		uint32_t tx_space);
+
+int BT_multi_remove(hc05_multi *set, hc05_dev *dev);
+
+uint32_t BT_multi_ready(hc05_multi_entry *entry);
+
+uint32_t BT_multi_poll(hc05_multi *set, hc05_multi_event *events, uint32_t max);
+
+uint32_t BT_multi_wait(hc05_multi *set, hc05_multi_event *events, uint32_t max,
+		uint32_t timeout_us);
+
+void BT_multi_isr(void *context);
+
+#endif /* HC_05_MULTI_H_ */
@@ -0,0 +1,51 @@
+#ifndef HC_05_TIME_H_
+#define HC_05_TIME_H_
+
+#include <stdint.h>
+#include "io.h"
+
+/*
+ * Internal header : clocks and waits of the driver modules, in one place.
+ *   BT_TIME_US(DEV)       : microseconds, for the timeouts,
+ *   BT_DELAY_US(DEV, US)  : wait US microseconds,
+ *   BT_CYCLES(DEV)        : cycle counter of the measures,
+ *   BT_CYCLES_HZ(DEV)     : its frequency.
+ * The host model gives its own in its io.h. On the Nios, a file asks for
+ * the ones it uses, so that it only needs those in the BSP, by defining
+ * before including this header :
+ *   BT_USE_TIME_US : alt_nticks(), needs a sys_clk_timer (ALT_SYS_CLK),
+ *   BT_USE_DELAY_US : usleep(),
+ *   BT_USE_CYCLES : the HAL timestamp driver, started with
+ *                   alt_timestamp_start().
+ */
+
+//TIMEOUT CLOCK DEFINES
+#if defined(BT_USE_TIME_US) && !defined(BT_TIME_US)
+#include "system.h"
+#include <sys/alt_alarm.h>
+//alt_nticks() only advances with a system clock timer : without one, no
+//timeout would ever end. ALT_SYS_CLK is "none" then, BT_SYS_CLK(none) is 1
+#define BT_SYS_CLK_none 1
+#define BT_SYS_CLK_(CLK) BT_SYS_CLK_ ## CLK
+#define BT_SYS_CLK(CLK) BT_SYS_CLK_(CLK)
+#if !defined(ALT_SYS_CLK) || BT_SYS_CLK(ALT_SYS_CLK)
+#error "the HC05 timeouts need a sys_clk_timer in the BSP (ALT_SYS_CLK), or a BT_TIME_US"
+#endif
+#define BT_TIME_US(DEV) \
+	((uint64_t) alt_nticks() * 1000000 / alt_ticks_per_second())
+#endif
+
+//BUSY WAIT DEFINES
+#if defined(BT_USE_DELAY_US) && !defined(BT_DELAY_US)
+#include <unistd.h>
+#define BT_DELAY_US(DEV, US) usleep(US)
+#endif
+
+//CYCLE COUNTER DEFINES
+#if defined(BT_USE_CYCLES) && !defined(BT_CYCLES)
+#include <sys/alt_timestamp.h>
+#define BT_CYCLES(DEV) ((uint64_t) alt_timestamp())
+#define BT_CYCLES_HZ(DEV) ((uint32_t) alt_timestamp_freq())
+#endif
+
+#endif /* HC_05_TIME_H_ */
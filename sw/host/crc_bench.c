@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "hc05_crc.h"
+
+/*
+ * Throughput of the table driven CRCs of hc05_crc.c against the bit at a time
+ * versions, over buffers of a frame payload size and of a Lepton frame.
+ *
+ * usage: crc_bench [megabytes]
+ *
+ * build: gcc -O2 -std=gnu99 -Isw sw/host/crc_bench.c sw/hc05_crc.c -o crc_bench
+ */
+
+/*
+ * CRC-16/CCITT one bit at a time, the reference of BT_crc16.
+ * name: crc16_bitwise
+ * @param crc    : the starting value, 0xFFFF for a new CRC,
+ *        data   : the bytes,
+ *        length : the amount of bytes.
+ * @return the CRC.
+ */
+static uint16_t crc16_bitwise(uint16_t crc, const void *data, uint32_t length) {
+	const uint8_t *p = (const uint8_t *) data;
+	for(uint32_t i = 0; i < length; ++i) {
+		crc ^= (uint16_t)p[i] << 8;
+		for(uint32_t b = 0; b < 8; ++b) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+/*
+ * CRC-32 one bit at a time, the reference of BT_crc32.
+ * name: crc32_bitwise
+ * @param crc    : the CRC of the previous bytes, 0 for a new CRC,
+ *        data   : the bytes,
+ *        length : the amount of bytes.
+ * @return the CRC.
+ */
+static uint32_t crc32_bitwise(uint32_t crc, const void *data, uint32_t length) {
+	const uint8_t *p = (const uint8_t *) data;
+	crc = ~crc;
+	for(uint32_t i = 0; i < length; ++i) {
+		crc ^= p[i];
+		for(uint32_t b = 0; b < 8; ++b) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+		}
+	}
+	return ~crc;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef uint32_t (*crc_fn)(const uint8_t *data, uint32_t length);
+
+static uint32_t run_crc16_bitwise(const uint8_t *d, uint32_t n) { return crc16_bitwise(0xFFFF, d, n); }
+static uint32_t run_crc16_table(const uint8_t *d, uint32_t n) { return BT_crc16(0xFFFF, d, n); }
+static uint32_t run_crc32_bitwise(const uint8_t *d, uint32_t n) { return crc32_bitwise(0, d, n); }
+static uint32_t run_crc32_table(const uint8_t *d, uint32_t n) { return BT_crc32(0, d, n); }
+
+/*
+ * Time one CRC over a buffer and print its throughput.
+ * name: bench
+ * @param name   : the name printed,
+ *        fn     : the CRC,
+ *        data   : the buffer,
+ *        length : its size,
+ *        total  : the bytes to go through, the buffer is run again until then.
+ * @return void
+ */
+static void bench(const char *name, crc_fn fn, const uint8_t *data,
+		uint32_t length, uint64_t total) {
+	uint64_t rounds = total / length + 1;
+	volatile uint32_t sink = 0;
+	double start = now();
+	for(uint64_t i = 0; i < rounds; ++i) {
+		sink ^= fn(data, length);
+	}
+	double elapsed = now() - start;
+	double bytes = (double) rounds * length;
+	printf("%-14s %6" PRIu32 " B  %9.1f MB/s  %6.2f ns/B\n", name, length,
+		bytes / elapsed / 1e6, elapsed * 1e9 / bytes);
+	(void) sink;
+}
+
+int main(int argc, char **argv) {
+	uint64_t total = (argc > 1 ? strtoull(argv[1], NULL, 0) : 64) << 20;
+	static uint8_t data[9600 + 3];
+	const uint32_t sizes[] = {64, 1000, 9600};
+	srand(1);
+	for(uint32_t i = 0; i < sizeof(data); ++i) {
+		data[i] = rand();
+	}
+
+	//check values and table/bitwise agreement, unaligned start and odd lengths
+	if(BT_crc16(0xFFFF, "123456789", 9) != 0x29B1
+			|| BT_crc32(0, "123456789", 9) != 0xCBF43926) {
+		fprintf(stderr, "bad check value\n");
+		return -1;
+	}
+	for(uint32_t len = 0; len < 64; ++len) {
+		if(BT_crc16(0x1234, data + 3, len) != crc16_bitwise(0x1234, data + 3, len)
+				|| BT_crc32(0, data + 3, len) != crc32_bitwise(0, data + 3, len)
+				|| BT_crc32(BT_crc32(0, data, len), data + len, 9)
+					!= crc32_bitwise(0, data, len + 9)) {
+			fprintf(stderr, "table and bitwise CRCs differ, length %" PRIu32 "\n", len);
+			return -1;
+		}
+	}
+
+	for(uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+		bench("crc16 bitwise", run_crc16_bitwise, data, sizes[i], total / 8);
+		bench("crc16 slice-4", run_crc16_table, data, sizes[i], total);
+		bench("crc32 bitwise", run_crc32_bitwise, data, sizes[i], total / 8);
+		bench("crc32 slice-8", run_crc32_table, data, sizes[i], total);
+	}
+	return 0;
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+
+#include "delta_rle.h"
+
+/**
+ * PC side of main_lepton : receives the binary PGM (P5) frames sent by
+ * lepton_send_capture_binary, or the P5 key frames and D5 delta coded frames
+ * sent by lepton_send_capture_delta, and writes each of them to a .pgm file.
+ *
+ * usage: lepton_receiver /dev/rfcomm0 [prefix]
+ * frames are written to <prefix>0000.pgm, <prefix>0001.pgm, ...
+ * The input can also be a file holding a recorded stream.
+ *
+ * build: gcc -O2 -std=gnu99 -Isw sw/host/lepton_receiver.c sw/delta_rle.c
+ *            -o lepton_receiver
+ */
+
+#define MAX_PIXELS (160 * 120)
+
+static uint8_t in_buf[4096];
+static uint32_t in_len, in_pos;
+
+static int get_byte(int fd) {
+	if(in_pos == in_len) {
+		ssize_t n = read(fd, in_buf, sizeof(in_buf));
+		if(n <= 0) {
+			return -1;
+		}
+		in_len = n;
+		in_pos = 0;
+	}
+	return in_buf[in_pos++];
+}
+
+static int get_bytes(int fd, uint8_t *data, uint32_t length) {
+	for(uint32_t i = 0; i < length; ++i) {
+		int c = get_byte(fd);
+		if(c < 0) {
+			return -1;
+		}
+		data[i] = c;
+	}
+	return 0;
+}
+
+/* PGM header field : skips whitespace and comments, reads a decimal number */
+static int get_number(int fd, uint32_t *val) {
+	int c;
+	do {
+		c = get_byte(fd);
+		if(c == '#') {
+			while(c >= 0 && c != '\n') {
+				c = get_byte(fd);
+			}
+		}
+	} while(c == ' ' || c == '\t' || c == '\r' || c == '\n');
+	if(c < '0' || c > '9') {
+		return -1;
+	}
+	*val = 0;
+	while(c >= '0' && c <= '9') {
+		*val = *val * 10 + (c - '0');
+		c = get_byte(fd);
+	}
+	return 0; //the single whitespace after maxval is consumed here
+}
+
+/* look for the "P5" or "D5" magic, resynchronizing on garbage */
+static int get_magic(int fd) {
+	int last = 0, c;
+	while((c = get_byte(fd)) >= 0) {
+		if((last == 'P' || last == 'D') && c == '5') {
+			return last;
+		}
+		last = c;
+	}
+	return -1;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+	static uint8_t pixels[MAX_PIXELS * 2];
+	static uint16_t frame[MAX_PIXELS];
+	delta_rle_dec dec;
+	int have_key = 0;
+	const char *prefix = argc > 2 ? argv[2] : "frame";
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s device [prefix]\n", argv[0]);
+		return -1;
+	}
+	int fd = open(argv[1], O_RDONLY | O_NOCTTY);
+	if(fd < 0) {
+		perror(argv[1]);
+		return -1;
+	}
+	struct termios tio;
+	if(tcgetattr(fd, &tio) == 0) { //raw mode if it is a serial port
+		cfmakeraw(&tio);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+
+	double start = now();
+	uint32_t frames = 0;
+	uint32_t width, height, max_value;
+	int type;
+	while((type = get_magic(fd)) >= 0) {
+		if(get_number(fd, &width) || get_number(fd, &height)
+				|| get_number(fd, &max_value)) {
+			fprintf(stderr, "bad header\n");
+			continue;
+		}
+		uint32_t size = width * height;
+		uint32_t bpp = max_value > 255 ? 2 : 1;
+		uint32_t length = size * bpp;
+		if(size > MAX_PIXELS) {
+			fprintf(stderr, "bad frame %" PRIu32 "x%" PRIu32 "\n", width, height);
+			continue;
+		}
+		if(type == 'P') { //key frame
+			if(get_bytes(fd, pixels, length)) {
+				break;
+			}
+			for(uint32_t i = 0; i < size; ++i) {
+				frame[i] = bpp == 2 ? (pixels[2 * i] << 8) | pixels[2 * i + 1] : pixels[i];
+			}
+			delta_rle_dec_init(&dec, frame, size);
+			have_key = 1;
+		} else { //delta frame
+			if(!have_key || dec.size != size) {
+				fprintf(stderr, "delta frame without key frame, skipped\n");
+				continue;
+			}
+			int c, r = 0;
+			while(r == 0 && (c = get_byte(fd)) >= 0) {
+				r = delta_rle_decode(&dec, c);
+			}
+			if(r != 1) {
+				fprintf(stderr, "corrupted delta frame, waiting for a key frame\n");
+				have_key = 0;
+				continue;
+			}
+			for(uint32_t i = 0; i < size; ++i) {
+				if(bpp == 2) {
+					pixels[2 * i] = frame[i] >> 8;
+					pixels[2 * i + 1] = frame[i] & 0xff;
+				} else {
+					pixels[i] = frame[i];
+				}
+			}
+		}
+
+		char name[256];
+		snprintf(name, sizeof(name), "%s%04" PRIu32 ".pgm", prefix, frames);
+		FILE *out = fopen(name, "wb");
+		if(out == NULL) {
+			perror(name);
+			return -1;
+		}
+		fprintf(out, "P5\n%" PRIu32 " %" PRIu32 "\n%" PRIu32 "\n", width, height, max_value);
+		fwrite(pixels, 1, length, out);
+		fclose(out);
+
+		++frames;
+		double elapsed = now() - start;
+		printf("%s : %" PRIu32 "x%" PRIu32 ", %.2f frames/s\n", name, width,
+			height, elapsed > 0 ? frames / elapsed : 0.0);
+		fflush(stdout);
+	}
+	close(fd);
+	return 0;
+}
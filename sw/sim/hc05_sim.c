@@ -0,0 +1,856 @@
+#include <string.h>
+#include <inttypes.h>
+
+#include "hc05_sim.h"
+#include "hc05.h"
+
+/*******************************************************************************
+ *  FIFO model
+ ******************************************************************************/
+
+static void fifo_reset(hc05_sim_fifo *f) {
+	f->head = 0;
+	f->count = 0;
+}
+
+static int fifo_push(hc05_sim_fifo *f, uint8_t word) {
+	if(f->count == f->depth) {
+		return -1; //overflow_checking => write ignored
+	}
+	f->data[(f->head + f->count) % f->depth] = word;
+	++f->count;
+	return 0;
+}
+
+static uint32_t depth_log2(uint32_t depth) {
+	uint32_t log2 = 0;
+	while((1u << log2) < depth) {
+		++log2;
+	}
+	return log2;
+}
+
+static uint8_t fifo_pop(hc05_sim_fifo *f) {
+	uint8_t word = f->data[f->head];
+	f->head = (f->head + 1) % f->depth;
+	--f->count;
+	return word;
+}
+
+/* CRC-16/CCITT of one more byte, as crc16_update in HC05_extension */
+static uint16_t crc16_update(uint16_t crc, uint8_t word) {
+	crc ^= (uint16_t)word << 8;
+	for(uint32_t b = 0; b < 8; ++b) {
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/* FIFO_in pop by the CPU, seen by the CRC_in accumulator */
+static uint8_t fifo_in_pop(hc05_sim *sim) {
+	uint8_t word = fifo_pop(&sim->fifo_in);
+	sim->crc_in = crc16_update(sim->crc_in, word);
+	return word;
+}
+
+/* FIFO_out push by the CPU, seen by the CRC_out accumulator */
+static void fifo_out_push(hc05_sim *sim, uint8_t word) {
+	if(fifo_push(&sim->fifo_out, word) == 0) {
+		sim->crc_out = crc16_update(sim->crc_out, word);
+		if(sim->fifo_out.count > sim->fifo_out_high) {
+			sim->fifo_out_high = sim->fifo_out.count;
+		}
+	}
+}
+
+/*******************************************************************************
+ *  DMA model
+ ******************************************************************************/
+
+/* 32 bits bus addresses : 256 windows of 16 MB on host memory */
+#define DMA_WINDOWS 256
+#define DMA_WINDOW_SIZE (1u << 24)
+static uint8_t *dma_windows[DMA_WINDOWS];
+static uint32_t dma_window_count;
+
+static uint8_t *dma_ptr(uint32_t addr) {
+	return dma_windows[addr >> 24] + (addr & (DMA_WINDOW_SIZE - 1));
+}
+
+/* TX channel : keep the FIFO_out full from memory */
+static void dma_tx_fill(hc05_sim *sim) {
+	while(sim->dma_tx_left != 0 && sim->fifo_out.count != sim->fifo_out.depth) {
+		fifo_out_push(sim, *dma_ptr(sim->dma_tx_addr));
+		++sim->dma_tx_addr;
+		if(--sim->dma_tx_left == 0) {
+			sim->i_pending |= BLT_I_PENDING_DMA_TX;
+		}
+	}
+}
+
+/* RX channel : empty the FIFO_in to memory */
+static void dma_rx_drain(hc05_sim *sim) {
+	while(sim->dma_rx_left != 0 && sim->fifo_in.count != 0) {
+		*dma_ptr(sim->dma_rx_addr) = fifo_in_pop(sim);
+		++sim->dma_rx_addr;
+		if(--sim->dma_rx_left == 0) {
+			sim->i_pending |= BLT_I_PENDING_DMA_RX;
+		}
+	}
+}
+
+/*******************************************************************************
+ *  UART model
+ ******************************************************************************/
+
+/* start, data, parity and stop bits of a frame */
+static uint32_t frame_bits(hc05_sim *sim) {
+	uint32_t bits = 1 + 8 + 1;
+	if(sim->ctrl & BLT_EVEN_PARITY) {
+		++bits;
+	}
+	if(sim->ctrl & BLT_STOP_1) {
+		++bits;
+	}
+	return bits;
+}
+
+/* cycles added by the baud_frac accumulator to the bits first..first+bits-1
+ * of a burst : bit k > 0 lasts one more cycle when the k-th sum carried */
+static uint32_t frac_cycles(hc05_sim *sim, uint64_t first, uint32_t bits) {
+	if(!(sim->ctrl & BLT_FRAC_BAUD)) {
+		return 0;
+	}
+	uint64_t before = first != 0 ? (first - 1) * sim->baud_frac / 256 : 0;
+	return (first + bits - 1) * sim->baud_frac / 256 - before;
+}
+
+/*
+ * Clock cycles needed by UART_BT to send one frame out of idle, from the fetch
+ * in snd_WAITING to the end of the last stop bit.
+ * name: hc05_sim_frame_cycles
+ * @param sim  : The HC05 model.
+ * @return the length of a transmitted frame in clock cycles.
+ *
+ * The transmitting state machine spends 1 cycle in snd_WAITING, then
+ * wait_cycles+1 per bit, one more per carry of the baud_frac accumulator with
+ * BLT_FRAC_BAUD. The frames after it in a burst do not go through
+ * snd_WAITING, and the accumulator goes on from one frame to the next.
+ */
+uint32_t hc05_sim_frame_cycles(hc05_sim *sim) {
+	uint32_t bits = frame_bits(sim);
+	return 1 + bits * (sim->wait_cycles + 1) + frac_cycles(sim, 0, bits);
+}
+
+/* cycles of the next frame on BLT_Tx, chained : it follows the previous one
+ * in a burst, the fetch in snd_WAITING not included */
+static uint32_t tx_frame_cycles(hc05_sim *sim, int chained) {
+	uint32_t bits = frame_bits(sim);
+	uint32_t cycles;
+	if(!chained) {
+		sim->tx_bits = 0;
+	}
+	cycles = bits * (sim->wait_cycles + 1) + frac_cycles(sim, sim->tx_bits, bits);
+	sim->tx_bits += bits;
+	return cycles;
+}
+
+/*
+ * Clock cycles needed by the remote side to put one frame on BLT_Rx,
+ * assuming an ideal UART sending frames back to back.
+ * name: hc05_sim_line_frame_cycles
+ * @param sim  : The HC05 model.
+ * @return the length of a received frame in clock cycles.
+ */
+uint32_t hc05_sim_line_frame_cycles(hc05_sim *sim) {
+	uint32_t bits = frame_bits(sim);
+	if(sim->line_bps != 0) {
+		return ((uint64_t) bits * sim->clk_hz + sim->line_bps / 2) / sim->line_bps;
+	}
+	return bits * sim->wait_cycles;
+}
+
+/* i_tx_low is raised when the FIFO_out level goes below the watermark */
+static void tx_low_update(hc05_sim *sim) {
+	int low = sim->fifo_out.count < sim->tx_watermark;
+	if(low && !sim->fifo_out_low) {
+		sim->i_pending |= BLT_I_PENDING_TX_LOW;
+	}
+	sim->fifo_out_low = low;
+}
+
+static void line_push(hc05_sim *sim, uint8_t byte, uint64_t t) {
+	if(sim->line_count == HC05_SIM_LINE_DEPTH) {
+		return;
+	}
+	uint32_t i = (sim->line_head + sim->line_count) % HC05_SIM_LINE_DEPTH;
+	sim->line[i] = byte;
+	sim->line_t[i] = t;
+	++sim->line_count;
+	sim->line_free = t;
+}
+
+/* i_rx_idle : rx_timeout bit times without a byte since the last one, at t */
+static void rx_idle_update(hc05_sim *sim, uint64_t t) {
+	if(!sim->rx_idle_armed || sim->rx_timeout == 0) {
+		return;
+	}
+	if(t >= sim->rx_last_t + (uint64_t) sim->rx_timeout * (sim->wait_cycles + 1)) {
+		sim->rx_idle_armed = 0;
+		if(sim->fifo_in.count != 0) {
+			sim->i_pending |= BLT_I_PENDING_RX_IDLE;
+		}
+	}
+}
+
+/* nBLT_RTS low again at the current cycle : a frame the remote side wanted
+ * to start while it was high starts now, and the frames after it follow */
+static void line_resume(hc05_sim *sim) {
+	if(sim->line_count == 0) {
+		return;
+	}
+	uint64_t start = sim->line_t[sim->line_head] - hc05_sim_line_frame_cycles(sim);
+	if(start < sim->rts_t || start >= sim->clk) {
+		return;
+	}
+	uint64_t delay = sim->clk - start;
+	for(uint32_t i = 0; i < sim->line_count; ++i) {
+		sim->line_t[(sim->line_head + i) % HC05_SIM_LINE_DEPTH] += delay;
+	}
+	sim->line_free += delay;
+	sim->rx_stall_cycles += delay;
+}
+
+/* nBLT_RTS follows the FIFO_in level, at time t */
+static void rts_update(hc05_sim *sim, uint64_t t) {
+	int high = (sim->ctrl & BLT_FLOW_CTRL) && sim->fifo_in.count >= sim->rts_threshold;
+	if(high && !sim->rts_high) {
+		sim->rts_t = t;
+	} else if(!high && sim->rts_high) {
+		line_resume(sim);
+	}
+	sim->rts_high = high;
+}
+
+/* BLT_Rx at time t after the start edge of a remote frame, wrong when t is
+ * closer than line_edge_cycles to an edge */
+static int line_sample(hc05_sim *sim, const uint8_t *bits, uint32_t n, uint64_t t) {
+	uint64_t pos = t * sim->line_bps; //clk_hz per bit
+	uint64_t idx = pos / sim->clk_hz;
+	uint64_t rem = pos % sim->clk_hz;
+	uint64_t edge = (uint64_t) sim->line_edge_cycles * sim->line_bps;
+	int val = idx < n ? bits[idx] : 1;
+	if(rem < edge || sim->clk_hz - rem < edge) {
+		val = !val;
+	}
+	return val;
+}
+
+/* bit k of the frame as seen by UART_BT, the start edge at t = 0 */
+static int rx_bit(hc05_sim *sim, const uint8_t *bits, uint32_t n, uint32_t k,
+		uint64_t shift) {
+	uint64_t period = ((uint64_t) sim->wait_cycles + 1) * 256;
+	if(sim->ctrl & BLT_FRAC_BAUD) {
+		period += sim->baud_frac;
+	}
+	if(sim->ctrl & BLT_RX_OVERSAMPLE) {
+		//ticks 16k+7..9, tick i at ceil(i*period/4096)
+		uint32_t ones = 0;
+		for(uint32_t i = 16 * k + 7; i <= 16 * k + 9; ++i) {
+			ones += line_sample(sim, bits, n, shift + (i * period + 4095) / 4096);
+		}
+		return ones >= 2;
+	}
+	//1 cycle to see the edge, wait_cycles/2 in rcv_START, then a bit per
+	//wait_cycles+1 cycles and one more per carry from the second data bit on
+	uint64_t t = 1 + sim->wait_cycles / 2 + (uint64_t) k * (sim->wait_cycles + 1);
+	if(sim->ctrl & BLT_FRAC_BAUD) {
+		t += (uint64_t) (k - 1) * sim->baud_frac / 256;
+	}
+	return line_sample(sim, bits, n, shift + t);
+}
+
+/* Receive a remote frame starting at edge : the byte, -1 if rejected, -2 if
+ * rejected for its parity bit */
+static int rx_frame(hc05_sim *sim, uint8_t byte, uint64_t edge) {
+	uint8_t bits[12];
+	uint32_t n = 0;
+	uint32_t parity = 0;
+	uint64_t shift = 0;
+	bits[n++] = 0;
+	for(uint32_t b = 0; b < 8; ++b) {
+		bits[n++] = (byte >> b) & 1;
+		parity ^= (byte >> b) & 1;
+	}
+	if(sim->ctrl & BLT_EVEN_PARITY) {
+		bits[n++] = parity ^ ((sim->ctrl & BLT_ODD_PARITY) == BLT_ODD_PARITY);
+	}
+	bits[n++] = 1;
+	if(sim->ctrl & BLT_STOP_1) {
+		bits[n++] = 1;
+	}
+	//still busy with the previous frame : the oversampling receiver waits for
+	//a falling edge and loses the frame, the other one starts late
+	if(edge < sim->rx_ready) {
+		if(sim->ctrl & BLT_RX_OVERSAMPLE) {
+			return -1;
+		}
+		shift = sim->rx_ready - edge;
+	}
+	uint32_t stop = (sim->ctrl & BLT_EVEN_PARITY) ? 10 : 9;
+	uint64_t period = ((uint64_t) sim->wait_cycles + 1) * 256
+		+ ((sim->ctrl & BLT_FRAC_BAUD) ? sim->baud_frac : 0);
+	if(sim->ctrl & BLT_RX_OVERSAMPLE) {
+		sim->rx_ready = edge + ((16 * stop + 10) * period + 4095) / 4096 + 2;
+	} else {
+		//stop bit sampled, then wait_cycles/2 in rcv_RESTART
+		sim->rx_ready = edge + shift + 1 + sim->wait_cycles / 2
+			+ (uint64_t) stop * period / 256 + sim->wait_cycles / 2;
+	}
+	if((sim->ctrl & BLT_RX_OVERSAMPLE) && rx_bit(sim, bits, n, 0, shift) != 0) {
+		return -1;
+	}
+	uint32_t data = 0;
+	parity = 0;
+	for(uint32_t b = 0; b < 8; ++b) {
+		uint32_t bit = rx_bit(sim, bits, n, 1 + b, shift);
+		data |= bit << b;
+		parity ^= bit;
+	}
+	if(sim->ctrl & BLT_EVEN_PARITY) {
+		parity ^= (sim->ctrl & BLT_ODD_PARITY) == BLT_ODD_PARITY;
+		if(rx_bit(sim, bits, n, 9, shift) != (int) parity) {
+			return -2;
+		}
+	}
+	if(rx_bit(sim, bits, n, stop, shift) != 1) {
+		return -1;
+	}
+	return data;
+}
+
+/* Bring the UART up to the current clock cycle */
+static void sim_step(hc05_sim *sim) {
+	//transmitter
+	int chained = 0;
+	dma_tx_fill(sim);
+	for(;;) {
+		if(sim->tx_active) {
+			if(sim->tx_done > sim->clk) {
+				break;
+			}
+			sim->tx_active = 0;
+			sim->tx_t = sim->tx_done;
+			sim->tx_busy_count += sim->tx_frame;
+			//the next byte was fetched during the stop bits
+			chained = 1;
+			++sim->tx_bytes;
+			if(sim->sink) {
+				sim->sink(sim->sink_arg, sim->tx_byte, sim->tx_done);
+			}
+			if(sim->loopback) {
+				line_push(sim, sim->tx_byte,
+					sim->tx_done > sim->line_free ? sim->tx_done : sim->line_free);
+			}
+		}
+		if((sim->ctrl & BLT_UART_ON) && sim->fifo_out.count != 0
+				&& (!(sim->ctrl & BLT_FLOW_CTRL) || sim->cts_ready)) {
+			sim->tx_byte = fifo_pop(&sim->fifo_out);
+			++sim->tx_count;
+			dma_tx_fill(sim);
+			tx_low_update(sim);
+			sim->tx_active = 1;
+			if(sim->tx_held) {
+				sim->tx_gap_count += sim->tx_t - sim->tx_held_t;
+				sim->tx_held = 0;
+			}
+			sim->tx_frame = tx_frame_cycles(sim, chained);
+			sim->tx_done = sim->tx_t + sim->tx_frame;
+			if(!chained) {
+				++sim->tx_gap_count;
+				++sim->tx_done;
+			}
+		} else {
+			//held by nBLT_CTS, the line is idle with a byte ready
+			if((sim->ctrl & BLT_UART_ON) && sim->fifo_out.count != 0) {
+				if(!sim->tx_held) {
+					sim->tx_held = 1;
+					sim->tx_held_t = sim->tx_t;
+				}
+			} else {
+				sim->tx_held = 0;
+			}
+			sim->tx_t = sim->clk;
+			break;
+		}
+	}
+	//receiver
+	rts_update(sim, sim->clk);
+	while(sim->line_count != 0 && sim->line_t[sim->line_head] <= sim->clk) {
+		uint8_t byte = sim->line[sim->line_head];
+		uint64_t t = sim->line_t[sim->line_head];
+		//a frame starting after nBLT_RTS went high waits for it to go low
+		if(sim->rts_high && t - hc05_sim_line_frame_cycles(sim) >= sim->rts_t) {
+			break;
+		}
+		sim->line_head = (sim->line_head + 1) % HC05_SIM_LINE_DEPTH;
+		--sim->line_count;
+		if(!(sim->ctrl & BLT_UART_ON)) {
+			continue;
+		}
+		rx_idle_update(sim, t);
+		if(sim->line_bps != 0) {
+			int data = rx_frame(sim, byte, t - hc05_sim_line_frame_cycles(sim));
+			if(data < 0) {
+				++sim->rx_errors;
+				if(data == -2) {
+					++sim->parity_count;
+				}
+				continue;
+			}
+			if(data != byte) {
+				++sim->rx_corrupted;
+			}
+			byte = data;
+		}
+		if(fifo_push(&sim->fifo_in, byte) == 0) {
+			if(sim->fifo_in.count >= sim->rx_watermark) {
+				sim->i_pending |= BLT_I_PENDING_RCV;
+			}
+			++sim->rx_bytes;
+			++sim->rx_count;
+			if(sim->fifo_in.count > sim->fifo_in_high) {
+				sim->fifo_in_high = sim->fifo_in.count;
+			}
+			rts_update(sim, t);
+		} else {
+			sim->i_pending |= BLT_I_PENDING_DROP;
+			++sim->rx_dropped;
+			++sim->drop_count;
+		}
+		sim->rx_last_t = t;
+		sim->rx_idle_armed = 1;
+		dma_rx_drain(sim);
+	}
+	rx_idle_update(sim, sim->clk);
+	dma_rx_drain(sim);
+}
+
+/*******************************************************************************
+ *  Model API
+ ******************************************************************************/
+
+/*
+ * Initialize the model in its reset state (nReset = '0').
+ * name: hc05_sim_init
+ * @param sim  : The HC05 model.
+ * @return void
+ *
+ * example: hc05_sim sim; hc05_sim_init(&sim);
+ * hc05_dev dev = hc05_inst(&sim);
+ */
+void hc05_sim_init(hc05_sim *sim) {
+	memset(sim, 0, sizeof(*sim));
+	sim->clk_hz = HC05_SIM_CLK_HZ;
+	sim->read_cycles = 2; //read + read_pending
+	sim->write_cycles = 1;
+	sim->crc_out = 0xFFFF;
+	sim->crc_in = 0xFFFF;
+	sim->fifo_out.depth = HC05_SIM_FIFO_DEPTH;
+	sim->fifo_in.depth = HC05_SIM_FIFO_DEPTH;
+	sim->rts_threshold = HC05_SIM_FIFO_DEPTH - 16;
+	sim->cts_ready = 1;
+}
+
+/*
+ * Set the depth of the FIFOs, as the FIFO_OUT_DEPTH_LOG2 and
+ * FIFO_IN_DEPTH_LOG2 generics of HC05_extension. Empties both FIFOs.
+ * name: hc05_sim_set_fifo_depth
+ * @param sim      : The HC05 model,
+ *        out_log2 : log2 of the FIFO_out depth, 10 to 14,
+ *        in_log2  : log2 of the FIFO_in depth, 10 to 14.
+ * @return 0, -1 if a depth is out of range (nothing is changed).
+ *
+ * example: hc05_sim_set_fifo_depth(&sim, 14, 12); //16K out, 4K in
+ */
+int hc05_sim_set_fifo_depth(hc05_sim *sim, uint32_t out_log2, uint32_t in_log2) {
+	if(out_log2 < 10 || out_log2 > 14 || in_log2 < 10 || in_log2 > 14) {
+		return -1;
+	}
+	fifo_reset(&sim->fifo_out);
+	fifo_reset(&sim->fifo_in);
+	sim->fifo_out.depth = 1u << out_log2;
+	sim->fifo_in.depth = 1u << in_log2;
+	sim->rts_threshold = sim->fifo_in.depth - 16;
+	return 0;
+}
+
+/*
+ * Set the function receiving the bytes sent on BLT_Tx.
+ * name: hc05_sim_set_sink
+ * @param sim  : The HC05 model,
+ *        sink : the callback, NULL to discard the bytes,
+ *        arg  : the first argument given to the callback.
+ * @return void
+ */
+void hc05_sim_set_sink(hc05_sim *sim, hc05_sim_sink sink, void *arg) {
+	sim->sink = sink;
+	sim->sink_arg = arg;
+}
+
+/*
+ * Connect BLT_Tx to BLT_Rx, every byte sent is received back.
+ * name: hc05_sim_set_loopback
+ * @param sim  : The HC05 model,
+ *        on   : 1 to connect, 0 to disconnect.
+ * @return void
+ */
+void hc05_sim_set_loopback(hc05_sim *sim, int on) {
+	sim->loopback = on;
+}
+
+/*
+ * Give the remote side its own baud rate : the frames it sends are sampled
+ * at the instants UART_BT would, see hc05_sim.h.
+ * name: hc05_sim_set_line_rate
+ * @param sim         : The HC05 model,
+ *        bps         : the rate of the remote side, 0 to go back to an ideal
+ *                      line at the rate of the receiver,
+ *        edge_cycles : samples closer than this to an edge read wrong
+ *                      (rise time, jitter, noise).
+ * @return void
+ *
+ * example: hc05_sim_set_line_rate(&sim, 921600, 4);
+ */
+void hc05_sim_set_line_rate(hc05_sim *sim, uint32_t bps, uint32_t edge_cycles) {
+	sim->line_bps = bps;
+	sim->line_edge_cycles = edge_cycles;
+}
+
+/*
+ * Drive nBLT_CTS as the remote side would, only seen with BLT_FLOW_CTRL.
+ * name: hc05_sim_set_cts
+ * @param sim   : The HC05 model,
+ *        ready : 1 for nBLT_CTS low (the remote side accepts frames), 0 to
+ *                hold the transmitter, the frame being sent is finished.
+ * @return void
+ *
+ * example: hc05_sim_set_cts(&sim, 0);
+ */
+void hc05_sim_set_cts(hc05_sim *sim, int ready) {
+	sim_step(sim);
+	sim->cts_ready = ready;
+}
+
+/*
+ * Let time pass without any bus access.
+ * name: hc05_sim_advance
+ * @param sim    : The HC05 model,
+ *        cycles : the amount of clock cycles.
+ * @return void
+ */
+void hc05_sim_advance(hc05_sim *sim, uint64_t cycles) {
+	sim->clk += cycles;
+	sim_step(sim);
+}
+
+/*
+ * Let time pass until the FIFO_out is empty and the last frame is sent.
+ * name: hc05_sim_drain
+ * @param sim  : The HC05 model.
+ * @return void
+ */
+void hc05_sim_drain(hc05_sim *sim) {
+	sim_step(sim);
+	while(sim->tx_active) {
+		sim->clk = sim->tx_done;
+		sim_step(sim);
+	}
+}
+
+/*
+ * Queue bytes sent by the remote side on BLT_Rx. The frames are sent back to
+ * back from now on, after the ones already queued.
+ * name: hc05_sim_inject
+ * @param sim    : The HC05 model,
+ *        data   : the bytes to send,
+ *        length : the amount of bytes.
+ * @return the amount of bytes queued.
+ *
+ * example: hc05_sim_inject(&sim, "OK\r\n", 4);
+ */
+uint32_t hc05_sim_inject(hc05_sim *sim, const char *data, uint32_t length) {
+	uint32_t frame = hc05_sim_line_frame_cycles(sim);
+	uint64_t t = sim->line_free > sim->clk ? sim->line_free : sim->clk;
+	uint32_t i;
+	for(i = 0; i < length && sim->line_count < HC05_SIM_LINE_DEPTH; ++i) {
+		t += frame;
+		line_push(sim, data[i], t);
+	}
+	return i;
+}
+
+/*
+ * Returns the level of the irq line of the extension.
+ * name: hc05_sim_irq
+ * @param sim  : The HC05 model.
+ * @return 1 if an enabled interrupt is pending, 0 otherwise.
+ */
+int hc05_sim_irq(hc05_sim *sim) {
+	uint32_t i_enable;
+	sim_step(sim);
+	i_enable = (sim->ctrl & (BLT_I_ENABLE_RCV | BLT_I_ENABLE_DROP)) >> 1;
+	//CTRL bits 9..6 enable i_pending bits 5..2
+	i_enable |= (sim->ctrl & (BLT_I_ENABLE_TX_LOW | BLT_I_ENABLE_DMA_TX
+		| BLT_I_ENABLE_DMA_RX | BLT_I_ENABLE_RX_IDLE)) >> 4;
+	return (i_enable & sim->i_pending) != 0;
+}
+
+/*
+ * Avalon read access, as seen by the slave of HC05_extension.
+ * name: hc05_sim_read
+ * @param sim    : The HC05 model,
+ *        offset : byte offset of the register.
+ * @return the register value.
+ */
+uint32_t hc05_sim_read(hc05_sim *sim, uint32_t offset) {
+	uint32_t val = 0;
+	if(sim->clk < sim->bus_free) {
+		sim->clk = sim->bus_free;
+	}
+	sim_step(sim);
+	++sim->bus_reads;
+	switch(offset) {
+	case BLT_CTRL_REG:
+		val = sim->ctrl;
+		break;
+	case BLT_STATUS_REG:
+		val = sim->i_pending;
+		break;
+	case BLT_UART_WAIT_CYCLES:
+		val = sim->wait_cycles;
+		break;
+	case BLT_UART_BAUD_FRAC:
+		val = sim->baud_frac;
+		break;
+	case BLT_FIFO_OUT_FREE_SPACE:
+		val = sim->fifo_out.depth - sim->fifo_out.count;
+		break;
+	case BLT_FIFO_IN_DATA:
+		if(sim->fifo_in.count != 0) {
+			sim->fifo_in_q = fifo_in_pop(sim);
+		}
+		val = sim->fifo_in_q;
+		break;
+	case BLT_FIFO_IN_PENDING_DATA:
+		val = sim->fifo_in.count; //full flag on bit 10, usedw wraps to 0
+		val |= sim->fifo_in_last_count << BLT_FIFO_IN_LAST_COUNT_SHIFT;
+		break;
+	case BLT_FIFO_IN_DATA32:
+		//the unpacker holds the read while it pops, one word per cycle
+		sim->fifo_in_last_count = 0;
+		while(sim->fifo_in_last_count < 4 && sim->fifo_in.count != 0) {
+			val |= (uint32_t)fifo_in_pop(sim) << (8 * sim->fifo_in_last_count);
+			++sim->fifo_in_last_count;
+		}
+		sim->clk += sim->fifo_in_last_count + 2;
+		break;
+	case BLT_TX_WATERMARK:
+		val = sim->tx_watermark;
+		break;
+	case BLT_CRC_OUT:
+		val = sim->crc_out;
+		break;
+	case BLT_CRC_IN:
+		val = sim->crc_in;
+		break;
+	case BLT_DMA_TX_ADDR:
+		val = sim->dma_tx_addr;
+		break;
+	case BLT_DMA_TX_LEN:
+		val = sim->dma_tx_left;
+		break;
+	case BLT_DMA_RX_ADDR:
+		val = sim->dma_rx_addr;
+		break;
+	case BLT_DMA_RX_LEN:
+		val = sim->dma_rx_left;
+		break;
+	case BLT_RX_WATERMARK:
+		val = sim->rx_watermark;
+		break;
+	case BLT_RX_TIMEOUT:
+		val = sim->rx_timeout;
+		break;
+	case BLT_RTS_THRESHOLD:
+		val = sim->rts_threshold;
+		break;
+	case BLT_TX_COUNT:
+		val = sim->tx_count;
+		break;
+	case BLT_RX_COUNT:
+		val = sim->rx_count;
+		break;
+	case BLT_DROP_COUNT:
+		val = sim->drop_count;
+		break;
+	case BLT_PARITY_ERRORS:
+		val = sim->parity_count;
+		break;
+	case BLT_FIFO_HIGH_WATER:
+		val = sim->fifo_in_high | sim->fifo_out_high << BLT_HIGH_WATER_OUT_SHIFT;
+		break;
+	case BLT_TX_BUSY_CYCLES:
+		val = sim->tx_busy_count;
+		break;
+	case BLT_TX_GAP_CYCLES:
+		val = sim->tx_gap_count;
+		break;
+	case BLT_CAPS:
+		val = BLT_CAPS_CRC | BLT_CAPS_DMA | depth_log2(sim->fifo_out.depth)
+			| depth_log2(sim->fifo_in.depth) << BLT_CAPS_FIFO_IN_LOG2_SHIFT;
+		break;
+	default:
+		break;
+	}
+	sim->clk += sim->read_cycles;
+	return val;
+}
+
+/*
+ * Avalon write access, as seen by the slave of HC05_extension.
+ * name: hc05_sim_write
+ * @param sim        : The HC05 model,
+ *        offset     : byte offset of the register,
+ *        data       : the 32 bits of as_writedata,
+ *        byteenable : the as_byteenable lanes, only used by FIFO_out_data32.
+ * @return void
+ */
+void hc05_sim_write(hc05_sim *sim, uint32_t offset, uint32_t data,
+		uint32_t byteenable) {
+	if(sim->clk < sim->bus_free) {
+		sim->clk = sim->bus_free;
+	}
+	sim_step(sim);
+	++sim->bus_writes;
+	switch(offset) {
+	case BLT_CTRL_REG:
+		sim->ctrl = data & 0x1fff;
+		break;
+	case BLT_STATUS_REG:
+		sim->i_pending &= data;
+		break;
+	case BLT_UART_WAIT_CYCLES:
+		sim->wait_cycles = data;
+		break;
+	case BLT_UART_BAUD_FRAC:
+		sim->baud_frac = data & 0xff;
+		break;
+	case BLT_FIFO_OUT_DATA:
+		fifo_out_push(sim, data & 0xff);
+		break;
+	case BLT_FIFO_OUT_DATA32:
+		//the packer pushes the enabled lanes, one per cycle after this one
+		sim->bus_free = sim->clk + sim->write_cycles;
+		for(uint32_t lane = 0; lane < 4; ++lane) {
+			if(byteenable & (1 << lane)) {
+				fifo_out_push(sim, data >> (8 * lane));
+				++sim->bus_free;
+			}
+		}
+		break;
+	case BLT_RESET_FIFO:
+		if(data & BLT_RESET_FIFO_IN) {
+			fifo_reset(&sim->fifo_in);
+			sim->i_pending &= ~(BLT_I_PENDING_RCV | BLT_I_PENDING_DROP
+				| BLT_I_PENDING_RX_IDLE);
+			sim->rx_idle_armed = 0;
+		}
+		if(data & BLT_RESET_FIFO_OUT) {
+			fifo_reset(&sim->fifo_out);
+		}
+		break;
+	case BLT_TX_WATERMARK:
+		sim->tx_watermark = data & (sim->fifo_out.depth - 1);
+		break;
+	case BLT_CRC_OUT:
+		sim->crc_out = data & 0xffff;
+		break;
+	case BLT_CRC_IN:
+		sim->crc_in = data & 0xffff;
+		break;
+	case BLT_DMA_TX_ADDR:
+		sim->dma_tx_addr = data;
+		break;
+	case BLT_DMA_TX_LEN: //starts an idle channel, 0 aborts
+		if(sim->dma_tx_left == 0 || data == 0) {
+			sim->dma_tx_left = data;
+		}
+		break;
+	case BLT_DMA_RX_ADDR:
+		sim->dma_rx_addr = data;
+		break;
+	case BLT_RX_WATERMARK:
+		sim->rx_watermark = data & (2 * sim->fifo_in.depth - 1);
+		break;
+	case BLT_RX_TIMEOUT:
+		sim->rx_timeout = data & 0xffff;
+		break;
+	case BLT_RTS_THRESHOLD:
+		sim->rts_threshold = data & (2 * sim->fifo_in.depth - 1);
+		break;
+	case BLT_TX_COUNT: //a write clears the counter
+		sim->tx_count = 0;
+		break;
+	case BLT_RX_COUNT:
+		sim->rx_count = 0;
+		break;
+	case BLT_DROP_COUNT:
+		sim->drop_count = 0;
+		break;
+	case BLT_PARITY_ERRORS:
+		sim->parity_count = 0;
+		break;
+	case BLT_FIFO_HIGH_WATER:
+		sim->fifo_in_high = 0;
+		sim->fifo_out_high = 0;
+		break;
+	case BLT_TX_BUSY_CYCLES:
+		sim->tx_busy_count = 0;
+		break;
+	case BLT_TX_GAP_CYCLES:
+		sim->tx_gap_count = 0;
+		break;
+	case BLT_DMA_RX_LEN:
+		if(sim->dma_rx_left == 0 || data == 0) {
+			sim->dma_rx_left = data;
+		}
+		break;
+	default:
+		break;
+	}
+	tx_low_update(sim);
+	sim_step(sim);
+	sim->clk += sim->write_cycles;
+}
+
+/*
+ * Bus address of a host buffer for the DMA registers, the model maps the
+ * 32 bits addresses back to host memory in 16 MB windows.
+ * name: hc05_sim_dma_addr
+ * @param ptr  : a host pointer.
+ * @return the bus address, 0xFFFFFFFF if there are no windows left.
+ */
+uint32_t hc05_sim_dma_addr(const void *ptr) {
+	uint8_t *p = (uint8_t *) ptr;
+	for(uint32_t i = 0; i < dma_window_count; ++i) {
+		if(p >= dma_windows[i] && p < dma_windows[i] + DMA_WINDOW_SIZE / 2) {
+			return (i << 24) | (uint32_t)(p - dma_windows[i]);
+		}
+	}
+	if(dma_window_count == DMA_WINDOWS) {
+		return 0xFFFFFFFF;
+	}
+	dma_windows[dma_window_count] = p;
+	return dma_window_count++ << 24;
+}
@@ -0,0 +1,169 @@
+#ifndef HC_05_SIM_H_
+#define HC_05_SIM_H_
+
+#include <stdint.h>
+
+/*
+ * Software model of the HC05 extension, used to run hc05.c on a host.
+ *
+ * The model follows hw/hdl :
+ *  - registers_BT : CTRL, STATUS (i_pending), UART_wait_cycles, reset_FIFO,
+ *    tx_watermark, rx_watermark, rx_timeout, rts_threshold, the link
+ *    counters and FIFO high water marks, and the
+ *    FIFO_out_data32 packer, FIFO_in_data32 unpacker and CRC accumulators
+ *    of HC05_extension,
+ *  - DMA_BT : both channels move bytes as soon as the FIFOs allow it (the
+ *    DMA masters are much faster than the UART), bus addresses come from
+ *    hc05_sim_dma_addr(),
+ *  - FIFO_out_BT / FIFO_in_BT : scfifo of 1024 words (DEPTH_LOG2 = 10) by
+ *    default, same usedw/full encoding,
+ *  - UART_BT : the transmitter drains FIFO_out one frame at a time, each frame
+ *    lasting as many clock cycles as the transmitting state machine needs for
+ *    the current UART_wait_cycles, UART_baud_frac, parity and stop bit
+ *    settings. By default the remote side sends at exactly the rate of the
+ *    receiver. hc05_sim_set_line_rate() gives it its own rate and an edge
+ *    uncertainty : each frame is then sampled at the instants the receiver
+ *    (one sample per bit, or 3 votes out of 16 ticks with BLT_RX_OVERSAMPLE)
+ *    would, samples closer than the uncertainty to an edge reading wrong.
+ *    With BLT_FLOW_CTRL, the remote side does not start a frame while
+ *    nBLT_RTS is high (FIFO_in at rts_threshold), the frames after it being
+ *    delayed, and the transmitter does not start one while the remote side
+ *    holds nBLT_CTS high (hc05_sim_set_cts()).
+ *
+ * Time is counted in clock cycles of the extension. Each Avalon access charges
+ * read_cycles or write_cycles, hc05_sim_advance() lets time pass without
+ * touching the bus (e.g. CPU doing something else).
+ *
+ * To build the driver against the model, put sw/sim before the Nios HAL in the
+ * include path: its io.h routes IORD/IOWR to hc05_sim_read/hc05_sim_write,
+ * and the base address given to hc05_inst() is a pointer to a hc05_sim.
+ */
+
+#define HC05_SIM_FIFO_DEPTH 1024     /* default depth, DEPTH_LOG2 = 10 */
+#define HC05_SIM_FIFO_MAX_DEPTH 16384 /* DEPTH_LOG2 = 14 */
+#define HC05_SIM_LINE_DEPTH 4096
+#define HC05_SIM_CLK_HZ 50000000
+
+/* FIFO model (scfifo, no show-ahead on the read side) */
+typedef struct {
+	uint8_t data[HC05_SIM_FIFO_MAX_DEPTH];
+	uint32_t depth;
+	uint32_t head;
+	uint32_t count;
+} hc05_sim_fifo;
+
+/* callback receiving every byte put on BLT_Tx, at clock cycle clk */
+typedef void (*hc05_sim_sink)(void *arg, uint8_t byte, uint64_t clk);
+
+/* hc05 model structure */
+typedef struct {
+	/* registers_BT */
+	uint32_t ctrl;
+	uint32_t i_pending;
+	uint32_t wait_cycles;
+	uint32_t baud_frac;
+	uint32_t tx_watermark;
+	int fifo_out_low;  /* FIFO_out level below tx_watermark, last cycle */
+	uint32_t rx_watermark;
+	uint32_t rx_timeout;
+	uint32_t rts_threshold;
+	int rts_high;        /* nBLT_RTS, FIFO_in at rts_threshold with flow on */
+	uint64_t rts_t;      /* time nBLT_RTS went high */
+	uint64_t rx_last_t;  /* arrival of the last byte received */
+	int rx_idle_armed;   /* a byte was received since the last i_rx_idle */
+	uint32_t tx_count;   /* link counters, 32 bits as the registers */
+	uint32_t rx_count;
+	uint32_t drop_count;
+	uint32_t parity_count;
+	uint32_t fifo_in_high;
+	uint32_t fifo_out_high;
+	uint32_t tx_busy_count; /* counted as each frame ends */
+	uint32_t tx_gap_count;
+	/* FIFOs */
+	hc05_sim_fifo fifo_out;
+	hc05_sim_fifo fifo_in;
+	uint8_t fifo_in_q; /* last word read, returned again on underflow */
+	uint32_t fifo_in_last_count; /* words returned by the last data32 read */
+	uint16_t crc_out;  /* CRC-16 of the words pushed to FIFO_out */
+	uint16_t crc_in;   /* CRC-16 of the words popped from FIFO_in */
+	/* DMA_BT */
+	uint32_t dma_tx_addr;
+	uint32_t dma_tx_left;
+	uint32_t dma_rx_addr;
+	uint32_t dma_rx_left;
+	/* time */
+	uint64_t clk;
+	uint32_t clk_hz;
+	uint32_t read_cycles;
+	uint32_t write_cycles;
+	uint64_t bus_free; /* the packer holds the bus (waitrequest) until then */
+	/* UART_BT transmitter */
+	int tx_active;
+	uint8_t tx_byte;
+	uint64_t tx_t;    /* time up to which the transmitter is simulated */
+	uint64_t tx_done; /* end of the frame being sent */
+	uint32_t tx_frame; /* its cycles on BLT_Tx */
+	uint64_t tx_bits; /* bits sent since the burst started, for baud_frac */
+	int tx_held;      /* a byte waits for nBLT_CTS since tx_held_t */
+	uint64_t tx_held_t;
+	/* BLT_Rx line : bytes sent by the remote side, with their arrival time */
+	uint8_t line[HC05_SIM_LINE_DEPTH];
+	uint64_t line_t[HC05_SIM_LINE_DEPTH];
+	uint32_t line_head;
+	uint32_t line_count;
+	uint64_t line_free; /* time at which the remote side can start a frame */
+	uint32_t line_bps;  /* rate of the remote side, 0 : same as the receiver */
+	uint32_t line_edge_cycles; /* uncertainty around each edge */
+	uint64_t rx_ready;  /* the receiver waits for a start bit from then on */
+	int cts_ready;      /* nBLT_CTS low, the remote side accepts frames */
+	/* BLT_Tx destination */
+	int loopback;
+	hc05_sim_sink sink;
+	void *sink_arg;
+	/* counters */
+	uint64_t bus_reads;
+	uint64_t bus_writes;
+	uint64_t tx_bytes;
+	uint64_t rx_bytes;
+	uint64_t rx_dropped;
+	uint64_t rx_errors;    /* frames rejected : start, parity or stop bit */
+	uint64_t rx_corrupted; /* frames accepted with wrong data bits */
+	uint64_t rx_stall_cycles; /* remote frames held back by nBLT_RTS */
+} hc05_sim;
+
+/*******************************************************************************
+ *  Model API
+ ******************************************************************************/
+
+void hc05_sim_init(hc05_sim *sim);
+
+void hc05_sim_set_sink(hc05_sim *sim, hc05_sim_sink sink, void *arg);
+
+void hc05_sim_set_loopback(hc05_sim *sim, int on);
+
+void hc05_sim_set_line_rate(hc05_sim *sim, uint32_t bps, uint32_t edge_cycles);
+
+void hc05_sim_set_cts(hc05_sim *sim, int ready);
+
+int hc05_sim_set_fifo_depth(hc05_sim *sim, uint32_t out_log2, uint32_t in_log2);
+
+uint32_t hc05_sim_frame_cycles(hc05_sim *sim);
+
+uint32_t hc05_sim_line_frame_cycles(hc05_sim *sim);
+
+void hc05_sim_advance(hc05_sim *sim, uint64_t cycles);
+
+void hc05_sim_drain(hc05_sim *sim);
+
+uint32_t hc05_sim_inject(hc05_sim *sim, const char *data, uint32_t length);
+
+int hc05_sim_irq(hc05_sim *sim);
+
+uint32_t hc05_sim_read(hc05_sim *sim, uint32_t offset);
+
+void hc05_sim_write(hc05_sim *sim, uint32_t offset, uint32_t data,
+		uint32_t byteenable);
+
+uint32_t hc05_sim_dma_addr(const void *ptr);
+
+#endif /* HC_05_SIM_H_ */
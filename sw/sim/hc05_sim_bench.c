@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "hc05.h"
+#include "hc05_sim.h"
+
+/**
+ * Host benchmark of the driver TX path against the HC05 model.
+ *
+ * For every baud_rate value, sends 1/4 s worth of line time through
+ * BT_send_message, trying again CHUNK frame times later while the FIFO_out
+ * is full, and reports :
+ *  - the throughput on BLT_Tx, in simulated time,
+ *  - the bus accesses per byte (refused calls included),
+ *  - the clock cycles of the extension spent in BT_send_message per byte,
+ *  - the host time and host CPU cycles spent in BT_send_message per byte.
+ * Only the driver calls are timed, not the time the model lets pass between
+ * them. The host figures include the register accesses of the model, which
+ * stand for the bus accesses.
+ *
+ * build: gcc -O2 -std=gnu99 -Isw/sim -Isw sw/hc05.c sw/sim/hc05_sim.c
+ *            sw/sim/hc05_sim_bench.c -o hc05_sim_bench
+ */
+
+#define CHUNK 64
+
+static const struct {
+	baud_rate rate;
+	uint32_t bps;
+} rates[] = {
+	{b4800, 4800}, {b9600, 9600}, {b19200, 19200}, {b38400, 38400},
+	{b57600, 57600}, {b115200, 115200}, {b230400, 230400},
+	{b460800, 460800}, {b921600, 921600}, {b1382400, 1382400}
+};
+
+static uint64_t host_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint64_t host_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return host_ns();
+#endif
+}
+
+int main() {
+	static hc05_sim sim;
+	char message[CHUNK];
+	for(uint32_t i = 0; i < CHUNK; ++i) {
+		message[i] = 'a' + i % 26;
+	}
+
+	printf("%8s %8s %10s %10s %10s %10s %10s %10s\n", "baud", "cycles",
+		"bytes/s", "reads/B", "writes/B", "drv_clk/B", "drv_ns/B", "drv_cpu/B");
+	for(uint32_t r = 0; r < sizeof(rates)/sizeof(rates[0]); ++r) {
+		hc05_sim_init(&sim);
+		hc05_dev dev = hc05_inst(&sim);
+		BT_set_CTRL(&dev, BLT_UART_ON | BLT_STOP_0 | BLT_NO_PARITY);
+		BT_set_baud_rate(&dev, rates[r].rate);
+
+		uint32_t total = sim.clk_hz / hc05_sim_frame_cycles(&sim) / 4;
+		if(total < 2 * sim.fifo_out.depth) {
+			total = 2 * sim.fifo_out.depth;
+		}
+		uint64_t retry = (uint64_t)hc05_sim_frame_cycles(&sim) * CHUNK;
+		uint64_t start_clk = sim.clk;
+		uint64_t start_reads = sim.bus_reads;
+		uint64_t start_writes = sim.bus_writes;
+		uint64_t clk = 0;
+		uint64_t ns = 0;
+		uint64_t cycles = 0;
+		for(uint32_t sent = 0; sent < total; sent += CHUNK) {
+			int check;
+			for(;;) {
+				uint64_t call_clk = sim.clk;
+				uint64_t call_ns = host_ns();
+				uint64_t call_cycles = host_cycles();
+				check = BT_send_message(&dev, message, CHUNK);
+				cycles += host_cycles() - call_cycles;
+				ns += host_ns() - call_ns;
+				clk += sim.clk - call_clk;
+				if(check != -1) {
+					break;
+				}
+				hc05_sim_advance(&sim, retry);
+			}
+		}
+		hc05_sim_drain(&sim);
+
+		uint64_t sim_cycles = sim.clk - start_clk;
+		printf("%8" PRIu32 " %8" PRIu32 " %10.0f %10.2f %10.2f %10.2f %10.1f %10.1f\n",
+			rates[r].bps, (uint32_t)rates[r].rate,
+			(double)sim.tx_bytes * sim.clk_hz / sim_cycles,
+			(double)(sim.bus_reads - start_reads) / sim.tx_bytes,
+			(double)(sim.bus_writes - start_writes) / sim.tx_bytes,
+			(double)clk / sim.tx_bytes,
+			(double)ns / sim.tx_bytes,
+			(double)cycles / sim.tx_bytes);
+	}
+	return 0;
+}
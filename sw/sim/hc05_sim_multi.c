@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "hc05.h"
+#include "hc05_multi.h"
+#include "hc05_sim.h"
+
+/**
+ * Host check of hc05_multi.c against one HC05 model per link, BLT_Tx looped
+ * back to BLT_Rx, at 115200 bits/s. For 1 to links links, every link sends
+ * bytes bytes by chunks of CHUNK and reads its echo back, served :
+ *  - "poll" : by BT_multi_wait, straight to the FIFOs,
+ *  - "irq"  : by BT_multi_poll over receive rings and transmit queues filled
+ *             by BT_multi_isr. The model has no interrupt controller : the
+ *             irq lines are looked at every IRQ_CHECK_US, when the CPU would
+ *             have been interrupted.
+ * Each line gives the aggregate throughput, in time of the models, against
+ * links times the rate of one link, and the calls made ; the data read back
+ * is checked.
+ *
+ * usage: hc05_sim_multi [links] [bytes]
+ *
+ * build: gcc -O2 -std=gnu99 -Isw/sim -Isw sw/hc05.c sw/hc05_multi.c
+ *            sw/sim/hc05_sim.c sw/sim/hc05_sim_multi.c -o hc05_sim_multi
+ */
+
+#define LINKS 4
+#define BYTES 4096
+#define CHUNK 64
+#define RING 1024
+#define IRQ_CHECK_US 20
+
+static hc05_sim sim[BT_MULTI_MAX];
+static hc05_dev dev[BT_MULTI_MAX];
+static char rx_ring[BT_MULTI_MAX][RING];
+static char tx_ring[BT_MULTI_MAX][RING];
+
+typedef struct {
+	char *tx;
+	char *rx;
+	uint32_t sent;
+	uint32_t got;
+} link_state;
+
+/* latest clock of the models, they run side by side */
+static uint64_t latest(uint32_t links) {
+	uint64_t clk = 0;
+	for(uint32_t i = 0; i < links; ++i) {
+		if(sim[i].clk > clk) {
+			clk = sim[i].clk;
+		}
+	}
+	return clk;
+}
+
+/* BT_multi_poll, the irq lines looked at between two rounds */
+static uint32_t irq_wait(hc05_multi *set, hc05_multi_event *events,
+		uint32_t links, uint64_t deadline) {
+	for(;;) {
+		for(uint32_t i = 0; i < links; ++i) {
+			if(hc05_sim_irq(&sim[i])) {
+				BT_multi_isr(set);
+				break;
+			}
+		}
+		uint32_t n = BT_multi_poll(set, events, links);
+		if(n != 0 || latest(links) > deadline) {
+			return n;
+		}
+		for(uint32_t i = 0; i < links; ++i) {
+			hc05_sim_advance(&sim[i], (uint64_t) IRQ_CHECK_US
+				* sim[i].clk_hz / 1000000);
+		}
+	}
+}
+
+static int run(uint32_t links, uint32_t bytes, int irq, link_state *state) {
+	hc05_multi set;
+	hc05_multi_event events[BT_MULTI_MAX];
+	uint32_t waits = 0;
+	uint32_t served = 0;
+	BT_multi_init(&set);
+	for(uint32_t i = 0; i < links; ++i) {
+		hc05_sim_init(&sim[i]);
+		hc05_sim_set_loopback(&sim[i], 1);
+		dev[i] = hc05_inst(&sim[i]);
+		BT_set_CTRL(&dev[i], BLT_UART_ON | BLT_STOP_0 | BLT_NO_PARITY);
+		BT_set_baud_rate(&dev[i], b115200);
+		if(irq) {
+			BT_rx_ring_init(&dev[i], rx_ring[i], RING);
+			BT_tx_ring_init(&dev[i], tx_ring[i], RING);
+			BT_set_tx_watermark(&dev[i], RING / 4);
+			BT_rx_irq_enable(&dev[i]);
+		}
+		state[i].sent = 0;
+		state[i].got = 0;
+		memset(state[i].rx, 0, bytes);
+		BT_multi_add(&set, &dev[i], BT_MULTI_RX | BT_MULTI_TX, CHUNK, &state[i]);
+	}
+	uint64_t start = latest(links);
+	uint64_t deadline = start + (uint64_t) 10 * sim[0].clk_hz;
+	uint32_t done = 0;
+	while(done < links) {
+		uint32_t n = irq ? irq_wait(&set, events, links, deadline)
+			: BT_multi_wait(&set, events, links, 1000000);
+		++waits;
+		if(n == 0) {
+			fprintf(stderr, "%u links %s : nothing ready\n", (unsigned) links,
+				irq ? "irq" : "poll");
+			return -1;
+		}
+		for(uint32_t e = 0; e < n; ++e) {
+			link_state *link = events[e].arg;
+			hc05_dev *d = events[e].dev;
+			++served;
+			if(events[e].events & BT_MULTI_TX) {
+				uint32_t length = bytes - link->sent < CHUNK ? bytes - link->sent
+					: CHUNK;
+				int check = irq ? BT_tx_enqueue(d, link->tx + link->sent, length)
+					: BT_send_message(d, link->tx + link->sent, length);
+				if(check != -1) {
+					link->sent += length;
+				}
+				if(link->sent == bytes) {
+					BT_multi_watch(&set, d, BT_MULTI_RX, 0);
+				}
+			}
+			if(events[e].events & BT_MULTI_RX) {
+				int got = irq ? (int) BT_rx_read(d, link->rx + link->got,
+						bytes - link->got)
+					: BT_read(d, link->rx + link->got, bytes - link->got);
+				if(got > 0) {
+					link->got += got;
+				}
+				if(link->got == bytes) {
+					BT_multi_watch(&set, d, 0, 0);
+					++done;
+				}
+			}
+		}
+	}
+	double seconds = (double)(latest(links) - start) / sim[0].clk_hz;
+	double one = (double) sim[0].clk_hz / hc05_sim_frame_cycles(&sim[0]);
+	int errors = 0;
+	for(uint32_t i = 0; i < links; ++i) {
+		errors += memcmp(state[i].tx, state[i].rx, bytes) != 0;
+	}
+	printf("%5u %5s %8.3f %10.0f %10.0f %7.3f %7u %7u %6d\n", (unsigned) links,
+		irq ? "irq" : "poll", seconds, links * bytes / seconds, links * one,
+		links * bytes / seconds / (links * one), (unsigned) waits,
+		(unsigned) served, errors);
+	return errors != 0 ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+	static link_state state[BT_MULTI_MAX];
+	uint32_t links = argc > 1 ? strtoul(argv[1], NULL, 0) : LINKS;
+	uint32_t bytes = argc > 2 ? strtoul(argv[2], NULL, 0) : BYTES;
+	if(links == 0 || links > BT_MULTI_MAX || bytes == 0) {
+		fprintf(stderr, "usage: %s [links 1..%d] [bytes]\n", argv[0],
+			BT_MULTI_MAX);
+		return 1;
+	}
+	for(uint32_t i = 0; i < links; ++i) {
+		state[i].tx = malloc(bytes);
+		state[i].rx = malloc(bytes);
+		if(state[i].tx == NULL || state[i].rx == NULL) {
+			perror("malloc");
+			return 1;
+		}
+		for(uint32_t k = 0; k < bytes; ++k) {
+			state[i].tx[k] = k * (i + 3) + i;
+		}
+	}
+
+	int status = 0;
+	printf("%5s %5s %8s %10s %10s %7s %7s %7s %6s\n", "links", "mode", "s",
+		"bytes/s", "max", "ratio", "waits", "served", "errors");
+	for(uint32_t n = 1; n <= links; ++n) {
+		for(int irq = 0; irq < 2; ++irq) {
+			if(run(n, bytes, irq, state) != 0) {
+				status = 1;
+			}
+		}
+	}
+	return status;
+}
@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "hc05.h"
+#include "hc05_bench.h"
+#include "hc05_sim.h"
+
+/**
+ * Host run of the benchmark of hc05_bench.c against the HC05 model, no
+ * hardware needed : BLT_Tx is looped back to BLT_Rx, as an echoing remote
+ * side at the same rate. Cycles are clock cycles of the model, the bus
+ * accesses being the only time spent in the driver. The model has no
+ * jitter : the echo percentiles are all the round trip time of the line.
+ *
+ * usage: hc05_sim_sweep [file.csv] [bytes]
+ *
+ * build: gcc -O2 -std=gnu99 -Isw/sim -Isw sw/hc05.c sw/hc05_baud.c
+ *            sw/hc05_at.c sw/hc05_bench.c sw/sim/hc05_sim.c
+ *            sw/sim/hc05_sim_sweep.c -o hc05_sim_sweep
+ */
+
+#define BYTES 4096
+
+int main(int argc, char **argv) {
+	static hc05_sim sim;
+	static char tx[4 * BYTES];
+	static char rx[4 * BYTES];
+	FILE *out = stdout;
+	uint32_t bytes = argc > 2 ? strtoul(argv[2], NULL, 0) : BYTES;
+	if(bytes == 0 || bytes > sizeof(tx)) {
+		fprintf(stderr, "bytes : 1 to %u\n", (unsigned) sizeof(tx));
+		return 1;
+	}
+	if(argc > 1 && (out = fopen(argv[1], "w")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	hc05_sim_init(&sim);
+	hc05_sim_set_loopback(&sim, 1);
+	hc05_dev dev = hc05_inst(&sim);
+	hc05_bench bench;
+	BT_bench_init(&bench, &dev, tx, rx, bytes);
+	BT_bench_run(&bench, out);
+	if(out != stdout) {
+		fclose(out);
+	}
+	return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef HC_05_SIM_IO_H_
+#define HC_05_SIM_IO_H_
+
+/*
+ * Host replacement for the Nios II HAL "io.h".
+ * Every access is forwarded to the HC05 model, BASE being a hc05_sim pointer.
+ * Narrow accesses are turned into 32 bits accesses with the matching
+ * byteenable, as the Avalon interconnect does for a 32 bits slave.
+ */
+
+#include <stdint.h>
+#include "hc05_sim.h"
+
+#define __HC05_SIM_LANE(OFFSET) (((uint32_t)(OFFSET)) & 3)
+#define __HC05_SIM_WORD(OFFSET) (((uint32_t)(OFFSET)) & ~3u)
+
+#define IORD_32DIRECT(BASE, OFFSET) \
+	hc05_sim_read((hc05_sim *)(BASE), (OFFSET))
+#define IORD_16DIRECT(BASE, OFFSET) \
+	((uint16_t)(hc05_sim_read((hc05_sim *)(BASE), __HC05_SIM_WORD(OFFSET)) \
+		>> (8 * __HC05_SIM_LANE(OFFSET))))
+#define IORD_8DIRECT(BASE, OFFSET) \
+	((uint8_t)(hc05_sim_read((hc05_sim *)(BASE), __HC05_SIM_WORD(OFFSET)) \
+		>> (8 * __HC05_SIM_LANE(OFFSET))))
+
+#define IOWR_32DIRECT(BASE, OFFSET, DATA) \
+	hc05_sim_write((hc05_sim *)(BASE), (OFFSET), (uint32_t)(DATA), 0xf)
+#define IOWR_16DIRECT(BASE, OFFSET, DATA) \
+	hc05_sim_write((hc05_sim *)(BASE), __HC05_SIM_WORD(OFFSET), \
+		((uint32_t)(uint16_t)(DATA)) << (8 * __HC05_SIM_LANE(OFFSET)), \
+		0x3u << __HC05_SIM_LANE(OFFSET))
+#define IOWR_8DIRECT(BASE, OFFSET, DATA) \
+	hc05_sim_write((hc05_sim *)(BASE), __HC05_SIM_WORD(OFFSET), \
+		((uint32_t)(uint8_t)(DATA)) << (8 * __HC05_SIM_LANE(OFFSET)), \
+		0x1u << __HC05_SIM_LANE(OFFSET))
+
+/* host pointers don't fit the 32 bits DMA registers, the model maps them */
+#define BT_DMA_ADDRESS(PTR) hc05_sim_dma_addr(PTR)
+
+/* waits let the model time pass instead of sleeping */
+#define BT_DELAY_US(DEV, US) \
+	hc05_sim_advance((hc05_sim *)(DEV)->base, \
+		(uint64_t)(US) * ((hc05_sim *)(DEV)->base)->clk_hz / 1000000)
+
+/* a set of devices (hc05_multi.h) is one model per device, all of them wait */
+#define BT_MULTI_DELAY_US(SET, US) \
+	do { \
+		for(uint32_t __i = 0; __i < (SET)->count; ++__i) { \
+			BT_DELAY_US((SET)->entry[__i].dev, (US)); \
+		} \
+	} while(0)
+
+/* timeouts read the clock of the model */
+#define BT_TIME_US(DEV) \
+	(((hc05_sim *)(DEV)->base)->clk * 1000000 / ((hc05_sim *)(DEV)->base)->clk_hz)
+
+/* the driver counters count clock cycles of the model */
+#define BT_CYCLES(DEV) (((hc05_sim *)(DEV)->base)->clk)
+#define BT_CYCLES_HZ(DEV) (((hc05_sim *)(DEV)->base)->clk_hz)
+
+#endif /* HC_05_SIM_IO_H_ */